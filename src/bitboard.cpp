@@ -41,6 +41,120 @@ namespace {
   Bitboard BishopTable[0x1480]; // To store bishop attacks
 
   void init_magics(Bitboard table[], Magic magics[], Direction directions[]);
+
+#if defined(USE_AVX2) || defined(USE_DISPATCH)
+
+  // A sliding direction as a left and a right shift, one of them being 64 that
+  // shifts everything out, and the mask of the squares that can be reached
+  // without wrapping around the board edge.
+  struct FillDirection {
+    uint64_t left, right;
+    Bitboard mask;
+  };
+
+  constexpr FillDirection RookFills[] = {
+    { 8, 64, AllSquares }, { 64, 8, AllSquares }, { 1, 64, ~FileABB }, { 64, 1, ~FileHBB }
+  };
+
+  constexpr FillDirection BishopFills[] = {
+    { 9, 64, ~FileABB }, { 7, 64, ~FileHBB }, { 64, 7, ~FileABB }, { 64, 9, ~FileHBB }
+  };
+
+  TARGET_AVX2 inline __m256i shift(__m256i b, __m256i left, __m256i right) {
+    return _mm256_or_si256(_mm256_sllv_epi64(b, left), _mm256_srlv_epi64(b, right));
+  }
+
+  // fill_attacks() returns the attacks of the sliders in 'from', one per lane,
+  // along the four directions of a bishop or a rook.
+  template<PieceType Pt>
+  TARGET_AVX2 __m256i fill_attacks(__m256i from, __m256i occupied) {
+
+    const __m256i empty = _mm256_xor_si256(occupied, _mm256_set1_epi64x(-1));
+    __m256i attacks = _mm256_setzero_si256();
+
+    for (const FillDirection& d : Pt == BISHOP ? BishopFills : RookFills)
+    {
+        const __m256i l1 = _mm256_set1_epi64x(d.left),      r1 = _mm256_set1_epi64x(d.right);
+        const __m256i l2 = _mm256_set1_epi64x(d.left * 2),  r2 = _mm256_set1_epi64x(d.right * 2);
+        const __m256i l4 = _mm256_set1_epi64x(d.left * 4),  r4 = _mm256_set1_epi64x(d.right * 4);
+        const __m256i mask = _mm256_set1_epi64x(d.mask);
+
+        __m256i gen = from;
+        __m256i pro = _mm256_and_si256(empty, mask);
+
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift(gen, l1, r1)));
+        pro = _mm256_and_si256(pro, shift(pro, l1, r1));
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift(gen, l2, r2)));
+        pro = _mm256_and_si256(pro, shift(pro, l2, r2));
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift(gen, l4, r4)));
+
+        attacks = _mm256_or_si256(attacks, _mm256_and_si256(mask, shift(gen, l1, r1)));
+    }
+
+    return attacks;
+  }
+
+  // Lanes collects the sliders moving along the same directions, four at a time
+  template<PieceType Pt>
+  struct Lanes {
+
+    TARGET_AVX2 void add(Bitboard attacks[], int idx, Square s, Bitboard occupied) {
+      from[count] = square_bb(s);
+      occ[count] = occupied;
+      target[count] = idx;
+
+      if (++count == 4)
+          flush(attacks);
+    }
+
+    TARGET_AVX2 void flush(Bitboard attacks[]) {
+
+      for (int i = count; i < 4; ++i)
+          from[i] = occ[i] = 0; // An empty lane attacks nothing
+
+      alignas(32) Bitboard result[4];
+
+      _mm256_store_si256((__m256i*)result,
+                         fill_attacks<Pt>(_mm256_load_si256((const __m256i*)from),
+                                          _mm256_load_si256((const __m256i*)occ)));
+
+      for (int i = 0; i < count; ++i)
+          attacks[target[i]] |= result[i];
+
+      count = 0;
+    }
+
+    alignas(32) Bitboard from[4], occ[4];
+    int target[4], count = 0;
+  };
+
+  TARGET_AVX2 void slider_attacks_avx2(const PieceType pt[], const Square s[],
+                                       const Bitboard occupied[], Bitboard attacks[], int n) {
+
+    Lanes<BISHOP> bishops;
+    Lanes<ROOK> rooks;
+
+    for (int i = 0; i < n; ++i)
+    {
+        assert(pt[i] == BISHOP || pt[i] == ROOK || pt[i] == QUEEN);
+
+        attacks[i] = 0;
+
+        if (pt[i] != ROOK)
+            bishops.add(attacks, i, s[i], occupied[i]);
+
+        if (pt[i] != BISHOP)
+            rooks.add(attacks, i, s[i], occupied[i]);
+    }
+
+    if (bishops.count)
+        bishops.flush(attacks);
+
+    if (rooks.count)
+        rooks.flush(attacks);
+  }
+
+#endif
 }
 
 
@@ -63,6 +177,27 @@ const std::string Bitboards::pretty(Bitboard b) {
 }
 
 
+/// slider_attacks() with AVX2 computes the attacks of four sliders at once, one
+/// per 64 bit lane, by Kogge-Stone occluded fills. Bishops and rooks are filled
+/// in separate batches, a queen takes a lane in each. Without AVX2 it falls back
+/// to the magic bitboards lookups.
+
+void slider_attacks(const PieceType pt[], const Square s[], const Bitboard occupied[],
+                    Bitboard attacks[], int n) {
+
+#if defined(USE_AVX2) || defined(USE_DISPATCH)
+  if (HasAvx2)
+  {
+      slider_attacks_avx2(pt, s, occupied, attacks, n);
+      return;
+  }
+#endif
+
+  for (int i = 0; i < n; ++i)
+      attacks[i] = attacks_bb(pt[i], s[i], occupied[i]);
+}
+
+
 /// Bitboards::init() initializes various bitboard tables. It is called at
 /// startup and relies on global objects to be already zero-initialized.
 
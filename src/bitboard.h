@@ -276,6 +276,13 @@ inline Bitboard attacks_bb(PieceType pt, Square s, Bitboard occupied) {
 }
 
 
+/// slider_attacks() computes the attacks of 'n' bishops, rooks or queens, each
+/// one with its own occupancy, as attacks_bb() would do for each of them.
+
+void slider_attacks(const PieceType pt[], const Square s[], const Bitboard occupied[],
+                    Bitboard attacks[], int n);
+
+
 /// popcount() counts the number of non-zero bits in a bitboard
 
 inline int popcount(Bitboard b) {
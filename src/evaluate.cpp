@@ -22,13 +22,19 @@
 #include <cassert>
 #include <cstring>   // For std::memset
 #include <iomanip>
+#include <iostream>
 #include <sstream>
 
 #include "bitboard.h"
 #include "evaluate.h"
 #include "material.h"
+#include "nnue.h"
 #include "pawns.h"
 #include "thread.h"
+#include "tune.h"
+#include "uci.h"
+
+bool Eval::useNNUE = false;
 
 namespace Trace {
 
@@ -38,7 +44,9 @@ namespace Trace {
     MATERIAL = 8, IMBALANCE, MOBILITY, THREAT, PASSED, SPACE, INITIATIVE, TOTAL, TERM_NB
   };
 
-  Score scores[TERM_NB][COLOR_NB];
+  // Per thread, so that positions can be traced in parallel
+  thread_local Score scores[TERM_NB][COLOR_NB];
+  thread_local int phase, scaleFactor;
 
   double to_cp(Value v) { return double(v) / PawnValueEg; }
 
@@ -70,20 +78,34 @@ namespace Trace {
 }
 
 using namespace Trace;
+using Material::EvalVariant;
 
 namespace {
 
-  // Threshold for space evaluation
-  constexpr Value SpaceThreshold = Value(12222);
+  // Thresholds for lazy evaluation, and for the choice between the classical
+  // and the NNUE evaluations.
+  constexpr Value LazyThreshold1 = Value(1400);
+  constexpr Value LazyThreshold2 = Value(1300);
+  constexpr Value NNUEThreshold1 = Value(550);
+  constexpr Value NNUEThreshold2 = Value(150);
+
+  // The attacks of the sliders are computed in a batch only in 'avx2=yes'
+  // builds. With runtime dispatch the magics are faster for the evaluation,
+  // and AVX2 is used only for the NNUE layers and slider_attacks().
+#if defined(USE_AVX2) && !defined(USE_DISPATCH)
+  constexpr bool BatchSliders = true;
+#else
+  constexpr bool BatchSliders = false;
+#endif
 
   // KingAttackWeights[PieceType] contains king attack weights by piece type
-  constexpr int KingAttackWeights[PIECE_TYPE_NB] = { 0, 0, 81, 52, 44, 10 };
+  TUNABLE int KingAttackWeights[PIECE_TYPE_NB] = { 0, 0, 81, 52, 44, 10 };
 
   // Penalties for enemy's safe checks
-  constexpr int QueenSafeCheck  = 780;
-  constexpr int RookSafeCheck   = 1080;
-  constexpr int BishopSafeCheck = 635;
-  constexpr int KnightSafeCheck = 790;
+  TUNABLE int QueenSafeCheck  = 780;
+  TUNABLE int RookSafeCheck   = 1080;
+  TUNABLE int BishopSafeCheck = 635;
+  TUNABLE int KnightSafeCheck = 790;
 
 #define S(mg, eg) make_score(mg, eg)
 
@@ -92,7 +114,7 @@ namespace {
 
   // MobilityBonus[PieceType-2][attacked] contains bonuses for middle and end game,
   // indexed by piece type and number of attacked squares in the mobility area.
-  constexpr Score MobilityBonus[][32] = {
+  TUNABLE Score MobilityBonus[][32] = {
     { S(-62,-81), S(-53,-56), S(-12,-30), S( -4,-14), S(  3,  8), S( 13, 15), // Knights
       S( 22, 23), S( 28, 27), S( 33, 33) },
     { S(-48,-59), S(-20,-23), S( 16, -3), S( 26, 13), S( 38, 24), S( 51, 42), // Bishops
@@ -110,61 +132,80 @@ namespace {
 
   // RookOnFile[semiopen/open] contains bonuses for each rook when there is
   // no (friendly) pawn on the rook file.
-  constexpr Score RookOnFile[] = { S(21, 4), S(47, 25) };
+  TUNABLE Score RookOnFile[] = { S(21, 4), S(47, 25) };
 
   // ThreatByMinor/ByRook[attacked PieceType] contains bonuses according to
   // which piece type attacks which one. Attacks on lesser pieces which are
   // pawn-defended are not considered.
-  constexpr Score ThreatByMinor[PIECE_TYPE_NB] = {
+  TUNABLE Score ThreatByMinor[PIECE_TYPE_NB] = {
     S(0, 0), S(5, 32), S(57, 41), S(77, 56), S(88, 119), S(79, 161)
   };
 
-  constexpr Score ThreatByRook[PIECE_TYPE_NB] = {
+  TUNABLE Score ThreatByRook[PIECE_TYPE_NB] = {
     S(0, 0), S(2, 44), S(36, 71), S(36, 61), S(0, 38), S(51, 38)
   };
 
   // PassedRank[Rank] contains a bonus according to the rank of a passed pawn
-  constexpr Score PassedRank[RANK_NB] = {
+  TUNABLE Score PassedRank[RANK_NB] = {
     S(0, 0), S(10, 28), S(17, 33), S(15, 41), S(62, 72), S(168, 177), S(276, 260)
   };
 
   // Assorted bonuses and penalties
-  constexpr Score BishopPawns         = S(  3,  7);
-  constexpr Score CorneredBishop      = S( 50, 50);
-  constexpr Score FlankAttacks        = S(  8,  0);
-  constexpr Score Hanging             = S( 69, 36);
-  constexpr Score KingProtector       = S(  7,  8);
-  constexpr Score KnightOnQueen       = S( 16, 12);
-  constexpr Score LongDiagonalBishop  = S( 45,  0);
-  constexpr Score MinorBehindPawn     = S( 18,  3);
-  constexpr Score Outpost             = S( 30, 21);
-  constexpr Score PassedFile          = S( 11,  8);
-  constexpr Score PawnlessFlank       = S( 17, 95);
-  constexpr Score ReachableOutpost    = S( 32, 10);
-  constexpr Score RestrictedPiece     = S(  7,  7);
-  constexpr Score RookOnQueenFile     = S(  7,  6);
-  constexpr Score SliderOnQueen       = S( 59, 18);
-  constexpr Score ThreatByKing        = S( 24, 89);
-  constexpr Score ThreatByPawnPush    = S( 48, 39);
-  constexpr Score ThreatBySafePawn    = S(173, 94);
-  constexpr Score TrappedRook         = S( 52, 30);
-  constexpr Score WeakQueen           = S( 49, 15);
-  constexpr Score WeakQueenProtection = S( 14,  0);
+  TUNABLE Score BishopPawns         = S(  3,  7);
+  TUNABLE Score CorneredBishop      = S( 50, 50);
+  TUNABLE Score FlankAttacks        = S(  8,  0);
+  TUNABLE Score Hanging             = S( 69, 36);
+  TUNABLE Score KingProtector       = S(  7,  8);
+  TUNABLE Score KnightOnQueen       = S( 16, 12);
+  TUNABLE Score LongDiagonalBishop  = S( 45,  0);
+  TUNABLE Score MinorBehindPawn     = S( 18,  3);
+  TUNABLE Score Outpost             = S( 30, 21);
+  TUNABLE Score PassedFile          = S( 11,  8);
+  TUNABLE Score PawnlessFlank       = S( 17, 95);
+  TUNABLE Score ReachableOutpost    = S( 32, 10);
+  TUNABLE Score RestrictedPiece     = S(  7,  7);
+  TUNABLE Score RookOnQueenFile     = S(  7,  6);
+  TUNABLE Score SliderOnQueen       = S( 59, 18);
+  TUNABLE Score ThreatByKing        = S( 24, 89);
+  TUNABLE Score ThreatByPawnPush    = S( 48, 39);
+  TUNABLE Score ThreatBySafePawn    = S(173, 94);
+  TUNABLE Score TrappedRook         = S( 52, 30);
+  TUNABLE Score WeakQueen           = S( 49, 15);
+  TUNABLE Score WeakQueenProtection = S( 14,  0);
+
+#ifdef USE_TUNE
+  bool Registered = Tune::add({
+    TUNE_PARAM(KingAttackWeights), TUNE_PARAM(QueenSafeCheck), TUNE_PARAM(RookSafeCheck),
+    TUNE_PARAM(BishopSafeCheck), TUNE_PARAM(KnightSafeCheck), TUNE_PARAM(MobilityBonus),
+    TUNE_PARAM(RookOnFile), TUNE_PARAM(ThreatByMinor), TUNE_PARAM(ThreatByRook),
+    TUNE_PARAM(PassedRank), TUNE_PARAM(BishopPawns), TUNE_PARAM(CorneredBishop),
+    TUNE_PARAM(FlankAttacks), TUNE_PARAM(Hanging), TUNE_PARAM(KingProtector),
+    TUNE_PARAM(KnightOnQueen), TUNE_PARAM(LongDiagonalBishop), TUNE_PARAM(MinorBehindPawn),
+    TUNE_PARAM(Outpost), TUNE_PARAM(PassedFile), TUNE_PARAM(PawnlessFlank),
+    TUNE_PARAM(ReachableOutpost), TUNE_PARAM(RestrictedPiece), TUNE_PARAM(RookOnQueenFile),
+    TUNE_PARAM(SliderOnQueen), TUNE_PARAM(ThreatByKing), TUNE_PARAM(ThreatByPawnPush),
+    TUNE_PARAM(ThreatBySafePawn), TUNE_PARAM(TrappedRook), TUNE_PARAM(WeakQueen),
+    TUNE_PARAM(WeakQueenProtection)
+  });
+#endif
 
 #undef S
 
-  // Evaluation class computes and stores attacks tables and other working data
-  template<Tracing T>
+  // Evaluation class computes and stores attacks tables and other working data.
+  // The variant V selects the terms compiled in, see Material::EvalVariant.
+  template<Tracing T, EvalVariant V = Material::FULL>
   class Evaluation {
 
   public:
     Evaluation() = delete;
-    explicit Evaluation(const Position& p) : pos(p) {}
+    Evaluation(const Position& p, Material::Entry* e) : pos(p), me(e) {}
+    explicit Evaluation(const Position& p) : Evaluation(p, Material::probe(p)) {}
     Evaluation& operator=(const Evaluation&) = delete;
     Value value();
 
   private:
     template<Color Us> void initialize();
+    void sliders();
     template<Color Us, PieceType Pt> Score pieces();
     template<Color Us> Score king() const;
     template<Color Us> Score threats() const;
@@ -188,6 +229,10 @@ namespace {
     // color, including x-rays. But diagonal x-rays through pawns are not computed.
     Bitboard attackedBy2[COLOR_NB];
 
+    // sliderAttacks[color][piece type - BISHOP][index] are the attacks of the
+    // bishops, rooks and queens in square order, when computed in a batch.
+    Bitboard sliderAttacks[COLOR_NB][QUEEN - BISHOP + 1][16];
+
     // kingRing[color] are the squares adjacent to the king plus some other
     // very near squares, depending on king position.
     Bitboard kingRing[COLOR_NB];
@@ -213,8 +258,8 @@ namespace {
 
   // Evaluation::initialize() computes king and pawn attacks, and the king ring
   // bitboard for a given color. This is done at the beginning of the evaluation.
-  template<Tracing T> template<Color Us>
-  void Evaluation<T>::initialize() {
+  template<Tracing T, EvalVariant V> template<Color Us>
+  void Evaluation<T, V>::initialize() {
 
     constexpr Color     Them = (Us == WHITE ? BLACK : WHITE);
     constexpr Direction Down = (Us == WHITE ? SOUTH : NORTH);
@@ -251,27 +296,68 @@ namespace {
   }
 
 
+  // Evaluation::sliders() computes the attacks of all bishops, rooks and queens
+  // of both colors at once, with the same x-ray occupancies used by pieces(). It
+  // is used only with BatchSliders, in AVX2 builds where slider_attacks() is
+  // vectorized.
+  template<Tracing T, EvalVariant V>
+  void Evaluation<T, V>::sliders() {
+
+    PieceType pt[COLOR_NB * 3 * 16];
+    Square sq[COLOR_NB * 3 * 16];
+    Bitboard occupied[COLOR_NB * 3 * 16], attacks[COLOR_NB * 3 * 16];
+    int n = 0;
+
+    for (Color c : { WHITE, BLACK })
+        for (PieceType p : { BISHOP, ROOK, QUEEN })
+            for (Bitboard b = pos.pieces(c, p); b; ++n)
+            {
+                pt[n] = p;
+                sq[n] = pop_lsb(&b);
+                occupied[n] = p == BISHOP ? pos.pieces() ^ pos.pieces(QUEEN)
+                            : p ==   ROOK ? pos.pieces() ^ pos.pieces(QUEEN) ^ pos.pieces(c, ROOK)
+                                          : pos.pieces();
+            }
+
+    slider_attacks(pt, sq, occupied, attacks, n);
+
+    n = 0;
+    for (Color c : { WHITE, BLACK })
+        for (PieceType p : { BISHOP, ROOK, QUEEN })
+            for (int i = 0, cnt = popcount(pos.pieces(c, p)); i < cnt; ++i)
+                sliderAttacks[c][p - BISHOP][i] = attacks[n++];
+  }
+
+
   // Evaluation::pieces() scores pieces of a given color and type
-  template<Tracing T> template<Color Us, PieceType Pt>
-  Score Evaluation<T>::pieces() {
+  template<Tracing T, EvalVariant V> template<Color Us, PieceType Pt>
+  Score Evaluation<T, V>::pieces() {
 
     constexpr Color     Them = (Us == WHITE ? BLACK : WHITE);
     constexpr Direction Down = (Us == WHITE ? SOUTH : NORTH);
     constexpr Bitboard OutpostRanks = (Us == WHITE ? Rank4BB | Rank5BB | Rank6BB
                                                    : Rank5BB | Rank4BB | Rank3BB);
-    const Square* pl = pos.squares<Pt>(Us);
-
-    Bitboard b, bb;
+    Bitboard b, bb, ours = pos.pieces(Us, Pt);
     Score score = SCORE_ZERO;
 
     attackedBy[Us][Pt] = 0;
 
-    for (Square s = *pl; s != SQ_NONE; s = *++pl)
+    if (V == Material::PAWNS_ONLY || (V >= Material::NO_QUEENS && Pt == QUEEN))
+        return score;
+
+    for (int i = 0; ours; ++i)
     {
+        Square s = pop_lsb(&ours);
+
         // Find attacked squares, including x-ray attacks for bishops and rooks
-        b = Pt == BISHOP ? attacks_bb<BISHOP>(s, pos.pieces() ^ pos.pieces(QUEEN))
+        b = BatchSliders && Pt != KNIGHT ? sliderAttacks[Us][Pt - BISHOP][i]
+          : Pt == BISHOP ? attacks_bb<BISHOP>(s, pos.pieces() ^ pos.pieces(QUEEN))
           : Pt ==   ROOK ? attacks_bb<  ROOK>(s, pos.pieces() ^ pos.pieces(QUEEN) ^ pos.pieces(Us, ROOK))
+#ifdef USE_INCREMENTAL_ATTACKS
+                         : pos.piece_attacks(s);
+#else
                          : pos.attacks_from<Pt>(s);
+#endif
 
         if (pos.blockers_for_king(Us) & s)
             b &= LineBB[pos.square<KING>(Us)][s];
@@ -372,8 +458,8 @@ namespace {
 
 
   // Evaluation::king() assigns bonuses and penalties to a king of a given color
-  template<Tracing T> template<Color Us>
-  Score Evaluation<T>::king() const {
+  template<Tracing T, EvalVariant V> template<Color Us>
+  Score Evaluation<T, V>::king() const {
 
     constexpr Color    Them = (Us == WHITE ? BLACK : WHITE);
     constexpr Bitboard Camp = (Us == WHITE ? AllSquares ^ Rank6BB ^ Rank7BB ^ Rank8BB
@@ -385,6 +471,7 @@ namespace {
     const Square ksq = pos.square<KING>(Us);
 
     // Init the score with king shelter and enemy pawns storm
+    pos.this_thread()->stats.count(Search::KING_SAFETY_PROBE);
     Score score = pe->king_safety<Us>(pos);
 
     // Attacked squares defended at most once by our queen or king
@@ -409,7 +496,8 @@ namespace {
 
     // Enemy queen safe checks: we count them only if they are from squares from
     // which we can't give a rook check, because rook checks are more valuable.
-    queenChecks =  (b1 | b2)
+    queenChecks =  V >= Material::NO_QUEENS ? 0
+                 : (b1 | b2)
                  & attackedBy[Them][QUEEN]
                  & safe
                  & ~attackedBy[Us][QUEEN]
@@ -454,7 +542,7 @@ namespace {
                  +  69 * kingAttacksCount[Them]
                  +   3 * kingFlankAttack * kingFlankAttack / 8
                  +       mg_value(mobility[Them] - mobility[Us])
-                 - 873 * !pos.count<QUEEN>(Them)
+                 - 873 * (V >= Material::NO_QUEENS || !pos.count<QUEEN>(Them))
                  - 100 * bool(attackedBy[Us][KNIGHT] & attackedBy[Us][KING])
                  -   6 * mg_value(score) / 8
                  -   4 * kingFlankDefense
@@ -481,8 +569,8 @@ namespace {
 
   // Evaluation::threats() assigns bonuses according to the types of the
   // attacking and the attacked pieces.
-  template<Tracing T> template<Color Us>
-  Score Evaluation<T>::threats() const {
+  template<Tracing T, EvalVariant V> template<Color Us>
+  Score Evaluation<T, V>::threats() const {
 
     constexpr Color     Them     = (Us == WHITE ? BLACK   : WHITE);
     constexpr Direction Up       = (Us == WHITE ? NORTH   : SOUTH);
@@ -554,7 +642,7 @@ namespace {
     score += ThreatByPawnPush * popcount(b);
 
     // Bonus for threats on the next moves against enemy queen
-    if (pos.count<QUEEN>(Them) == 1)
+    if (V < Material::NO_QUEENS && pos.count<QUEEN>(Them) == 1)
     {
         Square s = pos.square<QUEEN>(Them);
         safe = mobilityArea[Us] & ~stronglyProtected;
@@ -578,8 +666,8 @@ namespace {
   // Evaluation::passed() evaluates the passed pawns and candidate passed
   // pawns of the given color.
 
-  template<Tracing T> template<Color Us>
-  Score Evaluation<T>::passed() const {
+  template<Tracing T, EvalVariant V> template<Color Us>
+  Score Evaluation<T, V>::passed() const {
 
     constexpr Color     Them = (Us == WHITE ? BLACK : WHITE);
     constexpr Direction Up   = (Us == WHITE ? NORTH : SOUTH);
@@ -665,10 +753,10 @@ namespace {
   // twice. Finally, the space bonus is multiplied by a weight. The aim is to
   // improve play on game opening.
 
-  template<Tracing T> template<Color Us>
-  Score Evaluation<T>::space() const {
+  template<Tracing T, EvalVariant V> template<Color Us>
+  Score Evaluation<T, V>::space() const {
 
-    if (pos.non_pawn_material() < SpaceThreshold)
+    if (V >= Material::NO_SPACE || pos.non_pawn_material() < Eval::SpaceThreshold)
         return SCORE_ZERO;
 
     constexpr Color Them     = (Us == WHITE ? BLACK : WHITE);
@@ -702,8 +790,8 @@ namespace {
   // for the position. It is a second order bonus/malus based on the
   // known attacking/defending status of the players.
 
-  template<Tracing T>
-  Score Evaluation<T>::initiative(Score score) const {
+  template<Tracing T, EvalVariant V>
+  Score Evaluation<T, V>::initiative(Score score) const {
 
     Value mg = mg_value(score);
     Value eg = eg_value(score);
@@ -745,8 +833,8 @@ namespace {
 
   // Evaluation::scale_factor() computes the scale factor for the winning side
 
-  template<Tracing T>
-  ScaleFactor Evaluation<T>::scale_factor(Value eg) const {
+  template<Tracing T, EvalVariant V>
+  ScaleFactor Evaluation<T, V>::scale_factor(Value eg) const {
 
     Color strongSide = eg > VALUE_DRAW ? WHITE : BLACK;
     int sf = me->scale_factor(pos, strongSide);
@@ -771,14 +859,11 @@ namespace {
   // parts of the evaluation and returns the value of the position from the point
   // of view of the side to move.
 
-  template<Tracing T>
-  Value Evaluation<T>::value() {
+  template<Tracing T, EvalVariant V>
+  Value Evaluation<T, V>::value() {
 
     assert(!pos.checkers());
 
-    // Probe the material hash table
-    me = Material::probe(pos);
-
     // If we have a specialized evaluation function for the current material
     // configuration, call it and return.
     if (me->specialized_eval_exists())
@@ -799,12 +884,33 @@ namespace {
     pe = Pawns::probe(pos);
     score += pe->pawn_score(WHITE) - pe->pawn_score(BLACK);
 
+    // Early exit if the score is already far away from a draw, the terms left
+    // are not expected to change the outcome of the search. Never when tracing.
+    // Both thresholds grow by the non-pawn material / 64.
+    Search::StatsCollector& stats = pos.this_thread()->stats;
+
+    auto lazy_skip = [&](Value lazyThreshold) {
+        return   !T
+              && abs(mg_value(score) + eg_value(score)) / 2 > lazyThreshold + pos.non_pawn_material() / 64;
+    };
+
+    stats.count(Search::EVAL_CALL);
+
+    if (lazy_skip(LazyThreshold1))
+    {
+        stats.count(Search::LAZY_SKIP_PAWNS);
+        goto make_v;
+    }
+
     // Main evaluation begins here.
 
     // Initialize some tables/bitboards for both sides.
     initialize<WHITE>();
     initialize<BLACK>();
 
+    if (BatchSliders && V != Material::PAWNS_ONLY)
+        sliders();
+
     // Pieces should be evaluated first (populate attack tables)
     score += pieces<WHITE, KNIGHT>() - pieces<BLACK, KNIGHT>();
     score += pieces<WHITE, BISHOP>() - pieces<BLACK, BISHOP>();
@@ -814,6 +920,13 @@ namespace {
     // Mobility scores are ready now
     score += mobility[WHITE] - mobility[BLACK];
 
+    // Second chance to skip the king, threat and passed pawn terms
+    if (lazy_skip(LazyThreshold2))
+    {
+        stats.count(Search::LAZY_SKIP_PIECES);
+        goto make_v;
+    }
+
     // Now do the remaining eval stuff
     score += king<WHITE>() - king<BLACK>();
     score += threats<WHITE>() - threats<BLACK>();
@@ -821,6 +934,7 @@ namespace {
     score += space<WHITE>() - space<BLACK>();
     score += initiative(score);
 
+make_v:
     // Finally, interpolate between a middlegame and a (scaled by 'sf')
     // endgame score if necessary (tapered eval).
     Value v = mg_value(score);
@@ -843,11 +957,28 @@ namespace {
         Trace::add(PAWN, pe->pawn_score(WHITE), pe->pawn_score(BLACK));
         Trace::add(MOBILITY, mobility[WHITE], mobility[BLACK]);
         Trace::add(TOTAL, score);
+        Trace::phase = me->game_phase();
+        Trace::scaleFactor = scale_factor(eg_value(score));
     }
 
     return  (pos.side_to_move() == WHITE ? v : -v) + VALUE_TEMPO; // Side to move point of view
   }
 
+
+  // classical() runs the evaluation compiled for the material on the board
+  Value classical(const Position& pos) {
+
+    Material::Entry* me = Material::probe(pos);
+
+    switch (me->eval_variant())
+    {
+    case Material::NO_SPACE:   return Evaluation<NO_TRACE, Material::NO_SPACE  >(pos, me).value();
+    case Material::NO_QUEENS:  return Evaluation<NO_TRACE, Material::NO_QUEENS >(pos, me).value();
+    case Material::PAWNS_ONLY: return Evaluation<NO_TRACE, Material::PAWNS_ONLY>(pos, me).value();
+    default:                   return Evaluation<NO_TRACE>(pos, me).value();
+    }
+  }
+
 } // namespace
 
 
@@ -855,7 +986,53 @@ namespace {
 /// evaluation of the position from the point of view of the side to move.
 
 Value Eval::evaluate(const Position& pos) {
-  return Evaluation<NO_TRACE>(pos).value();
+
+  if (!useNNUE)
+      return classical(pos);
+
+  // With a large material imbalance the classical evaluation is accurate
+  // enough and faster, unless it finds the position close to balanced.
+  int r50 = 16 + pos.rule50_count();
+  Value psq = eg_value(pos.psq_score(WHITE) - pos.psq_score(BLACK));
+  Value v = VALUE_NONE;
+
+  if (abs(psq) * 16 > NNUEThreshold1 * r50)
+      v = classical(pos);
+
+  if (v == VALUE_NONE || abs(v) * 16 < NNUEThreshold2 * r50)
+      v = NNUE::evaluate(pos) * 5 / 4 + VALUE_TEMPO;
+
+  return Utility::clamp(v, VALUE_MATED_IN_MAX_PLY + 1, VALUE_MATE_IN_MAX_PLY - 1);
+}
+
+
+/// init_NNUE() loads the network named by the EvalFile option when the 'Use
+/// NNUE' option is set. If it cannot be loaded the classical evaluation is used.
+
+void Eval::init_NNUE() {
+
+  static std::string loadedFile;
+
+  std::string evalFile = Options["EvalFile"];
+  useNNUE = false;
+
+  if (!Options["Use NNUE"])
+      return;
+
+  if (evalFile != loadedFile)
+  {
+      loadedFile = NNUE::load(evalFile) ? evalFile : "";
+
+      if (loadedFile.empty())
+      {
+          sync_cout << "info string Unable to load NNUE network " << evalFile
+                    << ", using the classical evaluation" << sync_endl;
+          return;
+      }
+  }
+
+  sync_cout << "info string NNUE evaluation using " << evalFile << sync_endl;
+  useNNUE = true;
 }
 
 
@@ -896,5 +1073,42 @@ std::string Eval::trace(const Position& pos) {
 
   ss << "\nTotal evaluation: " << to_cp(v) << " (white side)\n";
 
+  if (useNNUE)
+  {
+      Value nnue = NNUE::evaluate(pos), hybrid = evaluate(pos);
+      Color us = pos.side_to_move();
+
+      ss << "NNUE evaluation:  " << to_cp(us == WHITE ? nnue : -nnue) << " (white side)\n"
+         << "Final evaluation: " << to_cp(us == WHITE ? hybrid : -hybrid) << " (white side)\n";
+  }
+
+  return ss.str();
+}
+
+
+/// trace_terms() evaluates like trace(), for tuning tools. It returns on one
+/// line the evaluation, the game phase, the endgame scale factor, and then the
+/// middlegame and endgame values of each term, all from white's point of view.
+/// The phase and scale factor are -1 if a specialized endgame function is used.
+
+std::string Eval::trace_terms(const Position& pos) {
+
+  std::memset(scores, 0, sizeof(scores));
+  phase = scaleFactor = -1;
+
+  pos.this_thread()->contempt = SCORE_ZERO; // Reset any dynamic contempt
+
+  Value v = Evaluation<TRACE>(pos).value();
+
+  std::stringstream ss;
+  ss << (pos.side_to_move() == WHITE ? v : -v) << " " << phase << " " << scaleFactor;
+
+  for (Term t : { MATERIAL, IMBALANCE, Term(PAWN), Term(KNIGHT), Term(BISHOP), Term(ROOK),
+                  Term(QUEEN), MOBILITY, Term(KING), THREAT, PASSED, SPACE, INITIATIVE })
+  {
+      Score s = scores[t][WHITE] - scores[t][BLACK];
+      ss << " " << mg_value(s) << " " << eg_value(s);
+  }
+
   return ss.str();
 }
@@ -29,9 +29,16 @@ class Position;
 
 namespace Eval {
 
+// The space term is zero below this non-pawn material
+constexpr Value SpaceThreshold = Value(12222);
+
+extern bool useNNUE;
+
 std::string trace(const Position& pos);
+std::string trace_terms(const Position& pos);
 
 Value evaluate(const Position& pos);
+void init_NNUE();
 }
 
 #endif // #ifndef EVALUATE_H_INCLUDED
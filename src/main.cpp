@@ -22,9 +22,11 @@
 
 #include "bitboard.h"
 #include "endgame.h"
+#include "material.h"
 #include "misc.h"
 #include "position.h"
 #include "search.h"
+#include "searchlog.h"
 #include "thread.h"
 #include "tt.h"
 #include "uci.h"
@@ -37,6 +39,8 @@ namespace PSQT {
 
 int main(int argc, char* argv[]) {
 
+  CPU::init();
+
   std::cout <<   engine_info() << "\n"
             << compiler_info() << std::endl;
 
@@ -46,12 +50,14 @@ int main(int argc, char* argv[]) {
   Position::init();
   Bitbases::init();
   Endgames::init();
+  Material::init();
   Threads.set(Options["Threads"]);
   Search::clear(); // After threads are up
 
   UCI::loop(argc, argv);
 
   Threads.set(0);
+  SearchLog::close();
 
   return 0;
 }
@@ -18,11 +18,16 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <atomic>
 #include <cassert>
+#include <cstdlib>   // For std::calloc, std::free
 #include <cstring>   // For std::memset
+#include <iostream>
 
+#include "evaluate.h"
 #include "material.h"
 #include "thread.h"
+#include "tune.h"
 
 using namespace std;
 
@@ -30,7 +35,7 @@ namespace {
 
   // Polynomial material imbalance parameters
 
-  constexpr int QuadraticOurs[][PIECE_TYPE_NB] = {
+  TUNABLE int QuadraticOurs[][PIECE_TYPE_NB] = {
     //            OUR PIECES
     // pair pawn knight bishop rook queen
     {1438                               }, // Bishop pair
@@ -41,7 +46,7 @@ namespace {
     {-189,   24, 117,   133,  -134, -6  }  // Queen
   };
 
-  constexpr int QuadraticTheirs[][PIECE_TYPE_NB] = {
+  TUNABLE int QuadraticTheirs[][PIECE_TYPE_NB] = {
     //           THEIR PIECES
     // pair pawn knight bishop rook queen
     {   0                               }, // Bishop pair
@@ -52,6 +57,10 @@ namespace {
     {  97,  100, -42,   137,  268,    0 }  // Queen
   };
 
+#ifdef USE_TUNE
+  bool Registered = Tune::add({ TUNE_PARAM(QuadraticOurs), TUNE_PARAM(QuadraticTheirs) });
+#endif
+
   // Endgame evaluation and scaling functions are accessed directly and not through
   // the function maps because they correspond to more than one material hash key.
   Endgame<KXK>    EvaluateKXK[] = { Endgame<KXK>(WHITE),    Endgame<KXK>(BLACK) };
@@ -106,22 +115,49 @@ namespace {
     return bonus;
   }
 
-} // namespace
+  // Slot of the direct table, the entry can be used once the state is READY
+  struct alignas(64) Slot {
+    Material::Entry entry;
+    std::atomic<uint8_t> state;
+  };
 
-namespace Material {
+  enum SlotState : uint8_t { EMPTY, BUSY, READY };
 
-/// Material::probe() looks up the current position's material configuration in
-/// the material hash table. It returns a pointer to the Entry if the position
-/// is found. Otherwise a new Entry is computed and stored there, so we don't
-/// have to recompute all when the same material configuration occurs again.
+  static_assert(sizeof(Slot) == 64, "Slot must fit a cache line");
 
-Entry* probe(const Position& pos) {
+  Slot* DirectTable;
 
-  Key key = pos.material_key();
-  Entry* e = pos.this_thread()->materialTable[key];
+  // direct_index() returns the index of the material configuration in the
+  // direct table, or -1 if it is not there. Two bishops of the same color and
+  // a bishop pair are different configurations.
+  int direct_index(const Position& pos) {
+
+    int idx = 0;
+
+    for (Color c : { WHITE, BLACK })
+    {
+        int n = pos.count<KNIGHT>(c), b = pos.count<BISHOP>(c);
+        int r = pos.count<ROOK>(c), q = pos.count<QUEEN>(c);
+
+        if (n > 2 || b > 2 || r > 2 || q > 1)
+            return -1;
+
+        b = b < 2 ? b : 2 + pos.bishop_pair(c);
+        idx = idx * Material::ColorConfigurations
+             + (((pos.count<PAWN>(c) * 3 + n) * 4 + b) * 3 + r) * 2 + q;
+    }
+
+    return idx;
+  }
+
+} // namespace
+
+namespace Material {
 
-  if (e->key == key)
-      return e;
+/// Material::compute() fills the entry of the current position's material
+/// configuration.
+
+static void compute(const Position& pos, Entry* e, Key key) {
 
   std::memset(e, 0, sizeof(Entry));
   e->key = key;
@@ -141,17 +177,21 @@ Entry* probe(const Position& pos) {
       e->gamePhase = Phase(((npm - EndgameLimit) * PHASE_MIDGAME) / (MidgameLimit - EndgameLimit));
   }
 
+  e->evalVariant =  npm_w + npm_b >= Eval::SpaceThreshold ? FULL
+                  : pos.pieces(QUEEN)                      ? NO_SPACE
+                  : npm_w + npm_b                          ? NO_QUEENS : PAWNS_ONLY;
+
   // Let's look if we have a specialized evaluation function for this particular
   // material configuration. Firstly we look for a fixed configuration one, then
   // for a generic one if the previous search failed.
   if ((e->evaluationFunction = Endgames::probe<Value>(key)) != nullptr)
-      return e;
+      return;
 
   for (Color c : { WHITE, BLACK })
       if (is_KXK(pos, c))
       {
           e->evaluationFunction = &EvaluateKXK[c];
-          return e;
+          return;
       }
 
   // No need to compute imbalance when material is even
@@ -179,7 +219,7 @@ Entry* probe(const Position& pos) {
   if (sf)
   {
       e->scalingFunction[sf->strongSide] = sf; // Only strong color assigned
-      return e;
+      return;
   }
 
   // We didn't find any specialized scaling function, so fall back on generic
@@ -227,6 +267,63 @@ Entry* probe(const Position& pos) {
   if (!pos.count<PAWN>(BLACK) && npm_b - npm_w <= BishopValueMg)
       e->factor[BLACK] = uint8_t(npm_b <  RookValueMg   ? SCALE_FACTOR_DRAW :
                                  npm_w <= BishopValueMg ? 4 : 14);
+}
+
+
+/// Material::init() allocates the direct table. Memory is zeroed by the system
+/// when first touched, so only the pages of the configurations met are used.
+/// Calling it again clears the table.
+
+void init() {
+
+  constexpr size_t Count = size_t(ColorConfigurations) * ColorConfigurations;
+
+  static void* mem = nullptr;
+
+  std::free(mem);
+  mem = std::calloc(Count * sizeof(Slot) + 63, 1);
+
+  if (!mem)
+  {
+      std::cerr << "Failed to allocate the material table" << std::endl;
+      exit(EXIT_FAILURE);
+  }
+
+  DirectTable = reinterpret_cast<Slot*>((uintptr_t(mem) + 63) & ~uintptr_t(63));
+}
+
+
+/// Material::probe() looks up the current position's material configuration in
+/// the direct table, or else in the material hash table. It returns a pointer
+/// to the Entry if the configuration is found. Otherwise a new Entry is computed
+/// and stored there, so we don't have to recompute all when the same material
+/// configuration occurs again.
+
+Entry* probe(const Position& pos) {
+
+  int idx = direct_index(pos);
+
+  if (idx >= 0)
+  {
+      Slot& slot = DirectTable[idx];
+      uint8_t state = slot.state.load(std::memory_order_acquire);
+
+      if (state == READY)
+          return &slot.entry;
+
+      if (state == EMPTY && slot.state.compare_exchange_strong(state, BUSY))
+      {
+          compute(pos, &slot.entry, pos.material_key());
+          slot.state.store(READY, std::memory_order_release);
+          return &slot.entry;
+      }
+  }
+
+  Key key = pos.material_key();
+  Entry* e = pos.this_thread()->materialTable[key];
+
+  if (e->key != key)
+      compute(pos, e, key);
 
   return e;
 }
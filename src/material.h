@@ -28,6 +28,17 @@
 
 namespace Material {
 
+/// EvalVariant tells which terms of the evaluation are known to be zero for a
+/// material configuration, so that an evaluation compiled without them can be
+/// used. Each variant also drops the terms dropped by the previous ones.
+
+enum EvalVariant : uint8_t {
+  FULL,       // Anything
+  NO_SPACE,   // Non-pawn material below Eval::SpaceThreshold
+  NO_QUEENS,  // And no queens
+  PAWNS_ONLY  // Only kings and pawns
+};
+
 /// Material::Entry contains various information about a material configuration.
 /// It contains a material imbalance evaluation, a function pointer to a special
 /// endgame evaluation function (which in most cases is NULL, meaning that the
@@ -41,6 +52,7 @@ struct Entry {
 
   Score imbalance(Color c) const { return make_score(value[c], value[c]); }
   Phase game_phase() const { return gamePhase; }
+  EvalVariant eval_variant() const { return evalVariant; }
   bool specialized_eval_exists() const { return evaluationFunction != nullptr; }
   Value evaluate(const Position& pos) const { return (*evaluationFunction)(pos); }
 
@@ -61,11 +73,22 @@ struct Entry {
                                                              // side (e.g. KPKP, KBPsK)
   int16_t value[COLOR_NB];
   uint8_t factor[COLOR_NB];
+  EvalVariant evalVariant;
   Phase gamePhase;
 };
 
 typedef HashTable<Entry, 8192> Table;
 
+/// Material configurations with at most two knights, bishops and rooks and one
+/// queen per side, that is almost all positions, are indexed directly into a
+/// table shared by all threads, in a slot of one cache line. A slot is computed
+/// by the first thread probing it and never changes after that. The other
+/// configurations, and those whose slot is being computed by another thread,
+/// are looked up in the per thread hash table.
+
+constexpr int ColorConfigurations = 9 * 3 * 4 * 3 * 2; // Pawns, knights, bishops, rooks, queens
+
+void init();
 Entry* probe(const Position& pos);
 
 } // namespace Material
@@ -395,3 +395,44 @@ void bindThisThread(size_t idx) {
 #endif
 
 } // namespace WinProcGroup
+
+
+#ifdef USE_DISPATCH
+bool HasPext, HasAvx2;
+#endif
+
+namespace CPU {
+
+void init() {
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+  __builtin_cpu_init();
+
+  bool popcnt = __builtin_cpu_supports("popcnt");
+  bool bmi2   = __builtin_cpu_supports("bmi2");
+  bool avx2   = __builtin_cpu_supports("avx2");
+
+  // AMD family 17h, that is Zen, Zen+ and Zen 2, runs pext in microcode
+  bool slowPext = __builtin_cpu_is("amdfam17h");
+
+#ifdef USE_DISPATCH
+  HasPext = bmi2 && !slowPext;
+  HasAvx2 = avx2;
+#else
+  if (HasPext && slowPext)
+      cout << "info string Warning: pext is slow on this CPU, "
+              "a build without BMI2 is faster" << endl;
+#endif
+
+  if ((HasPopCnt && !popcnt) || (HasPext && !bmi2) || (HasAvx2 && !avx2))
+  {
+      cerr << "This CPU does not support the instructions the engine was compiled for"
+           << endl;
+      exit(EXIT_FAILURE);
+  }
+
+#endif
+}
+
+} // namespace CPU
@@ -120,4 +120,14 @@ namespace WinProcGroup {
   void bindThisThread(size_t idx);
 }
 
+
+/// CPU::init() checks at startup that the processor has the instructions the
+/// engine is compiled for. With runtime dispatch it sets HasPext and HasAvx2
+/// instead. Pext is microcoded on AMD Zen 1 and 2 and slower than the magics
+/// there, so it is not selected on them, or a warning is printed.
+
+namespace CPU {
+  void init();
+}
+
 #endif // #ifndef MISC_H_INCLUDED
@@ -50,7 +50,7 @@ namespace {
 
 
   template<Color Us, GenType Type>
-  ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
+  ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard target, Bitboard pinned) {
 
     // Compute some compile time parameters relative to the white side
     constexpr Color     Them     = (Us == WHITE ? BLACK      : WHITE);
@@ -61,11 +61,28 @@ namespace {
     constexpr Direction UpLeft   = (Us == WHITE ? NORTH_WEST : SOUTH_EAST);
 
     const Square ksq = pos.square<KING>(Them);
+    const Square ourKsq = pos.square<KING>(Us);
     Bitboard emptySquares;
 
     Bitboard pawnsOn7    = pos.pieces(Us, PAWN) &  TRank7BB;
     Bitboard pawnsNotOn7 = pos.pieces(Us, PAWN) & ~TRank7BB;
 
+    // A pinned pawn can only push along a pin on its file, and capture towards
+    // the pinner along a diagonal pin.
+    Bitboard pushers = ~pinned | file_bb(ourKsq);
+    Bitboard rightCapturers = ~pinned, leftCapturers = ~pinned;
+
+    for (Bitboard b = pos.pieces(Us, PAWN) & pinned; b; )
+    {
+        Square s = pop_lsb(&b);
+
+        if (LineBB[ourKsq][s] & shift<UpRight>(square_bb(s)))
+            rightCapturers |= s;
+
+        if (LineBB[ourKsq][s] & shift<UpLeft>(square_bb(s)))
+            leftCapturers |= s;
+    }
+
     Bitboard enemies = (Type == EVASIONS ? pos.pieces(Them) & target:
                         Type == CAPTURES ? target : pos.pieces(Them));
 
@@ -74,8 +91,8 @@ namespace {
     {
         emptySquares = (Type == QUIETS || Type == QUIET_CHECKS ? target : ~pos.pieces());
 
-        Bitboard b1 = shift<Up>(pawnsNotOn7)   & emptySquares;
-        Bitboard b2 = shift<Up>(b1 & TRank3BB) & emptySquares;
+        Bitboard b1 = shift<Up>(pawnsNotOn7 & pushers) & emptySquares;
+        Bitboard b2 = shift<Up>(b1 & TRank3BB)         & emptySquares;
 
         if (Type == EVASIONS) // Consider only blocking squares
         {
@@ -92,7 +109,7 @@ namespace {
             // if the pawn is not on the same file as the enemy king, because we
             // don't generate captures. Note that a possible discovery check
             // promotion has been already generated amongst the captures.
-            Bitboard dcCandidateQuiets = pos.blockers_for_king(Them) & pawnsNotOn7;
+            Bitboard dcCandidateQuiets = pos.blockers_for_king(Them) & pawnsNotOn7 & pushers;
             if (dcCandidateQuiets)
             {
                 Bitboard dc1 = shift<Up>(dcCandidateQuiets) & emptySquares & ~file_bb(ksq);
@@ -125,9 +142,9 @@ namespace {
         if (Type == EVASIONS)
             emptySquares &= target;
 
-        Bitboard b1 = shift<UpRight>(pawnsOn7) & enemies;
-        Bitboard b2 = shift<UpLeft >(pawnsOn7) & enemies;
-        Bitboard b3 = shift<Up     >(pawnsOn7) & emptySquares;
+        Bitboard b1 = shift<UpRight>(pawnsOn7 & rightCapturers) & enemies;
+        Bitboard b2 = shift<UpLeft >(pawnsOn7 & leftCapturers ) & enemies;
+        Bitboard b3 = shift<Up     >(pawnsOn7 & pushers       ) & emptySquares;
 
         while (b1)
             moveList = make_promotions<Type, UpRight>(moveList, pop_lsb(&b1), ksq);
@@ -142,8 +159,8 @@ namespace {
     // Standard and en-passant captures
     if (Type == CAPTURES || Type == EVASIONS || Type == NON_EVASIONS)
     {
-        Bitboard b1 = shift<UpRight>(pawnsNotOn7) & enemies;
-        Bitboard b2 = shift<UpLeft >(pawnsNotOn7) & enemies;
+        Bitboard b1 = shift<UpRight>(pawnsNotOn7 & rightCapturers) & enemies;
+        Bitboard b2 = shift<UpLeft >(pawnsNotOn7 & leftCapturers ) & enemies;
 
         while (b1)
         {
@@ -171,8 +188,14 @@ namespace {
 
             assert(b1);
 
+            // En passant captures can also expose the king along the rank of
+            // the two pawns. They are rare enough to be tested one by one.
             while (b1)
-                *moveList++ = make<ENPASSANT>(pop_lsb(&b1), pos.ep_square());
+            {
+                Move m = make<ENPASSANT>(pop_lsb(&b1), pos.ep_square());
+                if (pos.legal(m))
+                    *moveList++ = m;
+            }
         }
     }
 
@@ -182,14 +205,16 @@ namespace {
 
   template<PieceType Pt, bool Checks>
   ExtMove* generate_moves(const Position& pos, ExtMove* moveList, Color us,
-                          Bitboard target) {
+                          Bitboard target, Bitboard pinned) {
 
     static_assert(Pt != KING && Pt != PAWN, "Unsupported piece type in generate_moves()");
 
-    const Square* pl = pos.squares<Pt>(us);
+    Bitboard bb = pos.pieces(us, Pt);
 
-    for (Square from = *pl; from != SQ_NONE; from = *++pl)
+    while (bb)
     {
+        Square from = pop_lsb(&bb);
+
         if (Checks)
         {
             if (    (Pt == BISHOP || Pt == ROOK || Pt == QUEEN)
@@ -205,6 +230,10 @@ namespace {
         if (Checks)
             b &= pos.check_squares(Pt);
 
+        // A pinned piece can only move along the pin ray
+        if (pinned & from)
+            b &= LineBB[pos.square<KING>(us)][from];
+
         while (b)
             *moveList++ = make_move(from, pop_lsb(&b));
     }
@@ -218,24 +247,34 @@ namespace {
 
     constexpr bool Checks = Type == QUIET_CHECKS; // Reduce template instantations
 
-    moveList = generate_pawn_moves<Us, Type>(pos, moveList, target);
-    moveList = generate_moves<KNIGHT, Checks>(pos, moveList, Us, target);
-    moveList = generate_moves<BISHOP, Checks>(pos, moveList, Us, target);
-    moveList = generate_moves<  ROOK, Checks>(pos, moveList, Us, target);
-    moveList = generate_moves< QUEEN, Checks>(pos, moveList, Us, target);
+    Bitboard pinned = pos.blockers_for_king(Us) & pos.pieces(Us);
+
+    moveList = generate_pawn_moves<Us, Type>(pos, moveList, target, pinned);
+    moveList = generate_moves<KNIGHT, Checks>(pos, moveList, Us, target, pinned);
+    moveList = generate_moves<BISHOP, Checks>(pos, moveList, Us, target, pinned);
+    moveList = generate_moves<  ROOK, Checks>(pos, moveList, Us, target, pinned);
+    moveList = generate_moves< QUEEN, Checks>(pos, moveList, Us, target, pinned);
 
     if (Type != QUIET_CHECKS && Type != EVASIONS)
     {
         Square ksq = pos.square<KING>(Us);
         Bitboard b = pos.attacks_from<KING>(ksq) & target;
         while (b)
-            *moveList++ = make_move(ksq, pop_lsb(&b));
+        {
+            Square to = pop_lsb(&b);
+            if (!(pos.attackers_to(to) & pos.pieces(~Us)))
+                *moveList++ = make_move(ksq, to);
+        }
 
         if ((Type != CAPTURES) && pos.can_castle(Us & ANY_CASTLING))
         {
             for(CastlingRights cr : { Us & KING_SIDE, Us & QUEEN_SIDE })
                 if (!pos.castling_impeded(cr) && pos.can_castle(cr))
-                    *moveList++ = make<CASTLING>(ksq, pos.castling_rook_square(cr));
+                {
+                    Move m = make<CASTLING>(ksq, pos.castling_rook_square(cr));
+                    if (pos.legal(m))
+                        *moveList++ = m;
+                }
         }
     }
 
@@ -245,9 +284,13 @@ namespace {
 } // namespace
 
 
-/// <CAPTURES>     Generates all pseudo-legal captures and queen promotions
-/// <QUIETS>       Generates all pseudo-legal non-captures and underpromotions
-/// <NON_EVASIONS> Generates all pseudo-legal captures and non-captures
+/// <CAPTURES>     Generates all legal captures and queen promotions
+/// <QUIETS>       Generates all legal non-captures and underpromotions
+/// <NON_EVASIONS> Generates all legal captures and non-captures
+///
+/// All the generators return legal moves only: the moves of pinned pieces are
+/// restricted to the pin ray and king moves to unattacked squares, so that the
+/// search does not have to call Position::legal() on each move.
 ///
 /// Returns a pointer to the end of the move list.
 
@@ -273,7 +316,7 @@ template ExtMove* generate<QUIETS>(const Position&, ExtMove*);
 template ExtMove* generate<NON_EVASIONS>(const Position&, ExtMove*);
 
 
-/// generate<QUIET_CHECKS> generates all pseudo-legal non-captures and knight
+/// generate<QUIET_CHECKS> generates all legal non-captures and knight
 /// underpromotions that give check. Returns a pointer to the end of the move list.
 template<>
 ExtMove* generate<QUIET_CHECKS>(const Position& pos, ExtMove* moveList) {
@@ -281,6 +324,8 @@ ExtMove* generate<QUIET_CHECKS>(const Position& pos, ExtMove* moveList) {
   assert(!pos.checkers());
 
   Color us = pos.side_to_move();
+  Square ksq = pos.square<KING>(us);
+  Bitboard pinned = pos.blockers_for_king(us) & pos.pieces(us);
   Bitboard dc = pos.blockers_for_king(~us) & pos.pieces(us);
 
   while (dc)
@@ -296,8 +341,15 @@ ExtMove* generate<QUIET_CHECKS>(const Position& pos, ExtMove* moveList) {
      if (pt == KING)
          b &= ~PseudoAttacks[QUEEN][pos.square<KING>(~us)];
 
+     if (pinned & from)
+         b &= LineBB[ksq][from];
+
      while (b)
-         *moveList++ = make_move(from, pop_lsb(&b));
+     {
+         Square to = pop_lsb(&b);
+         if (pt != KING || !(pos.attackers_to(to) & pos.pieces(~us)))
+             *moveList++ = make_move(from, to);
+     }
   }
 
   return us == WHITE ? generate_all<WHITE, QUIET_CHECKS>(pos, moveList, ~pos.pieces())
@@ -305,7 +357,7 @@ ExtMove* generate<QUIET_CHECKS>(const Position& pos, ExtMove* moveList) {
 }
 
 
-/// generate<EVASIONS> generates all pseudo-legal check evasions when the side
+/// generate<EVASIONS> generates all legal check evasions when the side
 /// to move is in check. Returns a pointer to the end of the move list.
 template<>
 ExtMove* generate<EVASIONS>(const Position& pos, ExtMove* moveList) {
@@ -314,23 +366,17 @@ ExtMove* generate<EVASIONS>(const Position& pos, ExtMove* moveList) {
 
   Color us = pos.side_to_move();
   Square ksq = pos.square<KING>(us);
-  Bitboard sliderAttacks = 0;
-  Bitboard sliders = pos.checkers() & ~pos.pieces(KNIGHT, PAWN);
 
-  // Find all the squares attacked by slider checkers. We will remove them from
-  // the king evasions in order to skip known illegal moves, which avoids any
-  // useless legality checks later on.
-  while (sliders)
+  // Generate evasions for king, capture and non capture moves. The king is
+  // removed from the board to catch the squares behind it on a slider's ray.
+  Bitboard b = pos.attacks_from<KING>(ksq) & ~pos.pieces(us);
+  while (b)
   {
-      Square checksq = pop_lsb(&sliders);
-      sliderAttacks |= LineBB[checksq][ksq] ^ checksq;
+      Square to = pop_lsb(&b);
+      if (!(pos.attackers_to(to, pos.pieces() ^ ksq) & pos.pieces(~us)))
+          *moveList++ = make_move(ksq, to);
   }
 
-  // Generate evasions for king, capture and non capture moves
-  Bitboard b = pos.attacks_from<KING>(ksq) & ~pos.pieces(us) & ~sliderAttacks;
-  while (b)
-      *moveList++ = make_move(ksq, pop_lsb(&b));
-
   if (more_than_one(pos.checkers()))
       return moveList; // Double check, only a king move can save the day
 
@@ -348,19 +394,6 @@ ExtMove* generate<EVASIONS>(const Position& pos, ExtMove* moveList) {
 template<>
 ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
 
-  Color us = pos.side_to_move();
-  Bitboard pinned = pos.blockers_for_king(us) & pos.pieces(us);
-  Square ksq = pos.square<KING>(us);
-  ExtMove* cur = moveList;
-
-  moveList = pos.checkers() ? generate<EVASIONS    >(pos, moveList)
-                            : generate<NON_EVASIONS>(pos, moveList);
-  while (cur != moveList)
-      if (   (pinned || from_sq(*cur) == ksq || type_of(*cur) == ENPASSANT)
-          && !pos.legal(*cur))
-          *cur = (--moveList)->move;
-      else
-          ++cur;
-
-  return moveList;
+  return pos.checkers() ? generate<EVASIONS    >(pos, moveList)
+                        : generate<NON_EVASIONS>(pos, moveList);
 }
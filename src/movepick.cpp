@@ -21,6 +21,7 @@
 #include <cassert>
 
 #include "movepick.h"
+#include "thread.h"
 
 namespace {
 
@@ -31,24 +32,25 @@ namespace {
     QSEARCH_TT, QCAPTURE_INIT, QCAPTURE, QCHECK_INIT, QCHECK
   };
 
-  // partial_insertion_sort() sorts moves in descending order up to and including
-  // a given limit. The order of moves smaller than the limit is left unspecified.
-  void partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
-
-    for (ExtMove *sortedEnd = begin, *p = begin + 1; p < end; ++p)
-        if (p->value >= limit)
-        {
-            ExtMove tmp = *p, *q;
-            *p = *++sortedEnd;
-            for (q = sortedEnd; q != begin && *(q - 1) < tmp; --q)
-                *q = *(q - 1);
-            *q = tmp;
-        }
-  }
-
 } // namespace
 
 
+/// partial_insertion_sort() sorts moves in descending order up to and including
+/// a given limit. The order of moves smaller than the limit is left unspecified.
+void partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
+
+  for (ExtMove *sortedEnd = begin, *p = begin + 1; p < end; ++p)
+      if (p->value >= limit)
+      {
+          ExtMove tmp = *p, *q;
+          *p = *++sortedEnd;
+          for (q = sortedEnd; q != begin && *(q - 1) < tmp; --q)
+              *q = *(q - 1);
+          *q = tmp;
+      }
+}
+
+
 /// Constructors of the MovePicker class. As arguments we pass information
 /// to help it to return the (presumably) good moves first, to decide which
 /// moves to return (in the quiescence search, for instance, we only want to
@@ -64,7 +66,7 @@ MovePicker::MovePicker(const Position& p, Move ttm, Depth d, const ButterflyHist
   assert(d > 0);
 
   stage = pos.checkers() ? EVASION_TT : MAIN_TT;
-  ttMove = ttm && pos.pseudo_legal(ttm) ? ttm : MOVE_NONE;
+  ttMove = ttm && pos.pseudo_legal(ttm) && pos.legal(ttm) ? ttm : MOVE_NONE;
   stage += (ttMove == MOVE_NONE);
 }
 
@@ -78,7 +80,8 @@ MovePicker::MovePicker(const Position& p, Move ttm, Depth d, const ButterflyHist
   stage = pos.checkers() ? EVASION_TT : QSEARCH_TT;
   ttMove =   ttm
           && (depth > DEPTH_QS_RECAPTURES || to_sq(ttm) == recaptureSquare)
-          && pos.pseudo_legal(ttm) ? ttm : MOVE_NONE;
+          && pos.pseudo_legal(ttm)
+          && pos.legal(ttm) ? ttm : MOVE_NONE;
   stage += (ttMove == MOVE_NONE);
 }
 
@@ -93,6 +96,7 @@ MovePicker::MovePicker(const Position& p, Move ttm, Value th, const CapturePiece
   ttMove =   ttm
           && pos.capture(ttm)
           && pos.pseudo_legal(ttm)
+          && pos.legal(ttm)
           && pos.see_ge(ttm, threshold) ? ttm : MOVE_NONE;
   stage += (ttMove == MOVE_NONE);
 }
@@ -148,8 +152,10 @@ Move MovePicker::select(Pred filter) {
 }
 
 /// MovePicker::next_move() is the most important method of the MovePicker class. It
-/// returns a new pseudo legal move every time it is called until there are no more
-/// moves left, picking the move with the highest score from a list of generated moves.
+/// returns a new legal move every time it is called until there are no more moves
+/// left, picking the move with the highest score from a list of generated moves.
+/// The generators return legal moves only, the TT move and the refutations, that
+/// come from tables, are checked here.
 Move MovePicker::next_move(bool skipQuiets) {
 
 top:
@@ -194,7 +200,8 @@ top:
   case REFUTATION:
       if (select<Next>([&](){ return    *cur != MOVE_NONE
                                     && !pos.capture(*cur)
-                                    &&  pos.pseudo_legal(*cur); }))
+                                    &&  pos.pseudo_legal(*cur)
+                                    &&  pos.legal(*cur); }))
           return *(cur - 1);
       ++stage;
       /* fallthrough */
@@ -207,6 +214,9 @@ top:
 
           score<QUIETS>();
           partial_insertion_sort(cur, endMoves, -3000 * depth);
+
+          pos.this_thread()->stats.count(Search::QUIET_GEN);
+          pos.this_thread()->stats.add(Search::QUIET_MOVES, endMoves - cur);
       }
 
       ++stage;
@@ -217,7 +227,10 @@ top:
           && select<Next>([&](){return   *cur != refutations[0].move
                                       && *cur != refutations[1].move
                                       && *cur != refutations[2].move;}))
+      {
+          pos.this_thread()->stats.count(Search::QUIET_TRIED);
           return *(cur - 1);
+      }
 
       // Prepare the pointers to loop over the bad captures
       cur = moves;
@@ -256,8 +269,33 @@ top:
       /* fallthrough */
 
   case QCHECK_INIT:
-      cur = moves;
-      endMoves = generate<QUIET_CHECKS>(pos, cur);
+  {
+      Thread* thisThread = pos.this_thread();
+      QuietChecksEntry* e = thisThread->quietChecksTable[pos.key()];
+      bool hit = e->key == pos.key() && e->occupied == pos.pieces();
+
+      thisThread->stats.count(Search::QCHECK_PROBE);
+      thisThread->stats.count(Search::QCHECK_HIT, hit);
+
+      cur = endMoves = moves;
+
+      if (hit)
+          for (int i = 0; i < e->count; ++i)
+              *endMoves++ = Move(e->moves[i]);
+      else
+      {
+          endMoves = generate<QUIET_CHECKS>(pos, cur);
+
+          if (endMoves - cur <= QuietChecksEntry::MaxMoves)
+          {
+              e->key = pos.key();
+              e->occupied = pos.pieces();
+              e->count = uint8_t(endMoves - cur);
+              for (int i = 0; i < e->count; ++i)
+                  e->moves[i] = uint16_t(cur[i].move);
+          }
+      }
+  }
 
       ++stage;
       /* fallthrough */
@@ -0,0 +1,366 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>   // For std::memcpy
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+#include "nnue.h"
+#include "position.h"
+
+using namespace Eval::NNUE;
+
+namespace {
+
+  constexpr uint32_t Version = 0x7AF32F16;
+
+  // Feature index offsets of each piece, from the point of view of each
+  // perspective. Kings are not features, 'PsEnd' planes per king square.
+  enum {
+    PS_NONE     =   0,
+    PS_W_PAWN   =   1, PS_B_PAWN   =  65,
+    PS_W_KNIGHT = 129, PS_B_KNIGHT = 193,
+    PS_W_BISHOP = 257, PS_B_BISHOP = 321,
+    PS_W_ROOK   = 385, PS_B_ROOK   = 449,
+    PS_W_QUEEN  = 513, PS_B_QUEEN  = 577,
+    PsEnd       = 641
+  };
+
+  constexpr int PieceSquareIndex[PIECE_NB][COLOR_NB] = {
+    { PS_NONE, PS_NONE },
+    { PS_W_PAWN, PS_B_PAWN }, { PS_W_KNIGHT, PS_B_KNIGHT }, { PS_W_BISHOP, PS_B_BISHOP },
+    { PS_W_ROOK, PS_B_ROOK }, { PS_W_QUEEN, PS_B_QUEEN }, { PS_NONE, PS_NONE },
+    { PS_NONE, PS_NONE }, { PS_NONE, PS_NONE },
+    { PS_B_PAWN, PS_W_PAWN }, { PS_B_KNIGHT, PS_W_KNIGHT }, { PS_B_BISHOP, PS_W_BISHOP },
+    { PS_B_ROOK, PS_W_ROOK }, { PS_B_QUEEN, PS_W_QUEEN }, { PS_NONE, PS_NONE },
+    { PS_NONE, PS_NONE }
+  };
+
+  constexpr int InputDimensions = SQUARE_NB * PsEnd;
+  constexpr int L1 = 32, L2 = 32;
+  constexpr int WeightScaleBits = 6;
+  constexpr int FvScale = 16;
+
+  // Structure hashes stored in the network file, computed as the trainer does
+  constexpr uint32_t affine_hash(uint32_t prev, int outDims) {
+    return (0xCC03DAE4u + outDims) ^ (prev >> 1) ^ (prev << 31);
+  }
+  constexpr uint32_t relu_hash(uint32_t prev) { return 0x538D24C7u + prev; }
+
+  constexpr uint32_t TransformerHash = (0x5D69D5B9u ^ 1) ^ (2 * HalfDimensions);
+  constexpr uint32_t NetworkHash = affine_hash(relu_hash(affine_hash(relu_hash(
+                                   affine_hash(0xEC42E90Du ^ (2 * HalfDimensions), L1)), L2)), 1);
+
+  // The feature transformer weights, 20 MB, are allocated when a network is loaded
+  struct FeatureTransformer {
+    int16_t biases[HalfDimensions];
+    int16_t weights[InputDimensions * HalfDimensions];
+  };
+
+  template<int InDims, int OutDims>
+  struct AffineLayer {
+
+    void propagate(const uint8_t* input, int32_t* output) const;
+#if defined(USE_AVX2) || defined(USE_DISPATCH)
+    TARGET_AVX2 void propagate_avx2(const uint8_t* input, int32_t* output) const;
+#endif
+
+    int32_t biases[OutDims];
+    alignas(32) int8_t weights[OutDims * InDims];
+  };
+
+  std::unique_ptr<FeatureTransformer> transformer;
+  AffineLayer<2 * HalfDimensions, L1> layer1;
+  AffineLayer<L1, L2> layer2;
+  AffineLayer<L2, 1> output;
+
+  // Dot products of uint8 inputs and int8 weights. With AVX2 'maddubs' does
+  // the multiplication and a first addition in 16 bits, which cannot overflow
+  // because the inputs are at most 127. SSE2 widens both operands to 16 bits.
+  template<int InDims, int OutDims>
+  void AffineLayer<InDims, OutDims>::propagate(const uint8_t* input, int32_t* out) const {
+
+    static_assert(InDims % 32 == 0, "Input dimensions must be a multiple of 32");
+
+#if defined(USE_AVX2) || defined(USE_DISPATCH)
+    if (HasAvx2)
+        return propagate_avx2(input, out);
+#endif
+
+    for (int i = 0; i < OutDims; ++i)
+    {
+        const int8_t* row = &weights[i * InDims];
+
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = zero;
+
+        for (int j = 0; j < InDims; j += 16)
+        {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + j));
+            __m128i w  = _mm_load_si128(reinterpret_cast<const __m128i*>(row + j));
+            __m128i sign = _mm_cmpgt_epi8(zero, w);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(in, zero), _mm_unpacklo_epi8(w, sign)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(in, zero), _mm_unpackhi_epi8(w, sign)));
+        }
+
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[i] = biases[i] + _mm_cvtsi128_si32(sum);
+
+#else
+        int32_t sum = biases[i];
+
+        for (int j = 0; j < InDims; ++j)
+            sum += input[j] * row[j];
+
+        out[i] = sum;
+#endif
+    }
+  }
+
+#if defined(USE_AVX2) || defined(USE_DISPATCH)
+  template<int InDims, int OutDims>
+  void AffineLayer<InDims, OutDims>::propagate_avx2(const uint8_t* input, int32_t* out) const {
+
+    for (int i = 0; i < OutDims; ++i)
+    {
+        const int8_t* row = &weights[i * InDims];
+
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+
+        for (int j = 0; j < InDims; j += 32)
+        {
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + j));
+            __m256i w  = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + j));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        out[i] = biases[i] + _mm_cvtsi128_si32(s);
+    }
+  }
+#endif
+
+  template<int Dims>
+  void clipped_relu(const int32_t* input, uint8_t* out) {
+
+    for (int i = 0; i < Dims; ++i)
+        out[i] = uint8_t(std::max(0, std::min(127, input[i] >> WeightScaleBits)));
+  }
+
+  // Feature index of a piece for a perspective, with the board seen from
+  // that side. 'ksq' is the oriented square of the king of the perspective.
+  inline int make_index(Color perspective, Square s, Piece pc, Square ksq) {
+    return int(s ^ (perspective * 63)) + PieceSquareIndex[pc][perspective] + PsEnd * int(ksq);
+  }
+
+  inline Square oriented_king(const Position& pos, Color perspective) {
+    return Square(pos.square<KING>(perspective) ^ (perspective * 63));
+  }
+
+  inline void add_weights(int16_t* acc, int index) {
+    const int16_t* w = &transformer->weights[index * HalfDimensions];
+    for (int j = 0; j < HalfDimensions; ++j)
+        acc[j] += w[j];
+  }
+
+  inline void sub_weights(int16_t* acc, int index) {
+    const int16_t* w = &transformer->weights[index * HalfDimensions];
+    for (int j = 0; j < HalfDimensions; ++j)
+        acc[j] -= w[j];
+  }
+
+  // refresh() computes the accumulator of a perspective from scratch
+  void refresh(const Position& pos, Color perspective, int16_t* acc) {
+
+    Square ksq = oriented_king(pos, perspective);
+    Bitboard b = pos.pieces() & ~pos.pieces(KING);
+
+    std::memcpy(acc, transformer->biases, sizeof(transformer->biases));
+
+    while (b)
+    {
+        Square s = pop_lsb(&b);
+        add_weights(acc, make_index(perspective, s, pos.piece_on(s), ksq));
+    }
+  }
+
+  // update_accumulator() brings the accumulator of the current position up to
+  // date. For each perspective we look back for the closest position with a
+  // computed accumulator, and replay the pieces changed since then if this is
+  // cheaper than a refresh. A move of the king of the perspective changes all
+  // its features, so we cannot look back further.
+  const Accumulator& update_accumulator(const Position& pos) {
+
+    StateInfo* st = pos.state();
+    Accumulator& acc = st->accumulator;
+
+    if (acc.computed)
+        return acc;
+
+    int budget = popcount(pos.pieces()) / 2;
+
+    for (Color p : { WHITE, BLACK })
+    {
+        const StateInfo* computed = nullptr;
+        int changes = 0;
+
+        for (const StateInfo* s = st; s->previous; s = s->previous)
+        {
+            const DirtyPiece& dp = s->dirtyPiece;
+
+            changes += dp.dirtyNum;
+
+            if (changes > budget || (dp.dirtyNum && dp.piece[0] == make_piece(p, KING)))
+                break;
+
+            if (s->previous->accumulator.computed)
+            {
+                computed = s->previous;
+                break;
+            }
+        }
+
+        if (!computed)
+        {
+            refresh(pos, p, acc.accumulation[p]);
+            continue;
+        }
+
+        Square ksq = oriented_king(pos, p);
+
+        std::memcpy(acc.accumulation[p], computed->accumulator.accumulation[p], sizeof(acc.accumulation[p]));
+
+        for (const StateInfo* s = st; s != computed; s = s->previous)
+        {
+            const DirtyPiece& dp = s->dirtyPiece;
+
+            for (int i = 0; i < dp.dirtyNum; ++i)
+            {
+                if (type_of(dp.piece[i]) == KING)
+                    continue;
+
+                if (dp.from[i] != SQ_NONE)
+                    sub_weights(acc.accumulation[p], make_index(p, dp.from[i], dp.piece[i], ksq));
+
+                if (dp.to[i] != SQ_NONE)
+                    add_weights(acc.accumulation[p], make_index(p, dp.to[i], dp.piece[i], ksq));
+            }
+        }
+    }
+
+    acc.computed = true;
+    return acc;
+  }
+
+  template<typename T>
+  bool read(std::istream& stream, T* data, size_t count) {
+    stream.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+    return !stream.fail();
+  }
+
+  template<typename T>
+  bool read_layer(std::istream& stream, T& layer) {
+    return   read(stream, layer.biases, sizeof(layer.biases) / sizeof(layer.biases[0]))
+          && read(stream, layer.weights, sizeof(layer.weights) / sizeof(layer.weights[0]));
+  }
+
+  bool read_network(std::istream& stream, FeatureTransformer& ft) {
+
+    uint32_t version, hash, size;
+    std::string description;
+
+    if (   !read(stream, &version, 1) || version != Version
+        || !read(stream, &hash, 1) || hash != (TransformerHash ^ NetworkHash)
+        || !read(stream, &size, 1))
+        return false;
+
+    description.resize(size);
+
+    if (   !read(stream, &description[0], size)
+        || !read(stream, &hash, 1) || hash != TransformerHash
+        || !read_layer(stream, ft)
+        || !read(stream, &hash, 1) || hash != NetworkHash
+        || !read_layer(stream, layer1)
+        || !read_layer(stream, layer2)
+        || !read_layer(stream, output))
+        return false;
+
+    return stream.peek() == std::ios::traits_type::eof();
+  }
+
+} // namespace
+
+
+/// NNUE::load() reads a network file. Returns false, leaving the evaluator
+/// unusable until a network is loaded, if the file is missing or invalid.
+
+bool Eval::NNUE::load(const std::string& evalFile) {
+
+  std::ifstream stream(evalFile, std::ios::binary);
+  std::unique_ptr<FeatureTransformer> ft(new FeatureTransformer);
+
+  transformer.reset();
+
+  if (!stream || !read_network(stream, *ft))
+      return false;
+
+  transformer = std::move(ft);
+  return true;
+}
+
+
+/// NNUE::evaluate() returns the network evaluation of the position, from the
+/// point of view of the side to move. A network must have been loaded.
+
+Value Eval::NNUE::evaluate(const Position& pos) {
+
+  assert(transformer);
+
+  alignas(32) uint8_t transformed[2 * HalfDimensions];
+  alignas(32) uint8_t hidden1[L1], hidden2[L2];
+  int32_t out1[L1], out2[L2], out;
+
+  const Accumulator& acc = update_accumulator(pos);
+  const Color perspectives[] = { pos.side_to_move(), ~pos.side_to_move() };
+
+  for (int p = 0; p < 2; ++p)
+      for (int j = 0; j < HalfDimensions; ++j)
+          transformed[p * HalfDimensions + j] =
+              uint8_t(std::max(0, std::min(127, int(acc.accumulation[perspectives[p]][j]))));
+
+  layer1.propagate(transformed, out1);
+  clipped_relu<L1>(out1, hidden1);
+  layer2.propagate(hidden1, out2);
+  clipped_relu<L2>(out2, hidden2);
+  output.propagate(hidden2, &out);
+
+  return Value(out / FvScale);
+}
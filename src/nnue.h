@@ -0,0 +1,63 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NNUE_H_INCLUDED
+#define NNUE_H_INCLUDED
+
+#include <string>
+
+#include "types.h"
+
+class Position;
+
+/// NNUE is an efficiently updatable neural network evaluation. Networks use the
+/// HalfKP 2x41024-256-32-32-1 layout and the file format of Stockfish 12. The
+/// output of the first layer, the feature transformer, is kept in StateInfo as
+/// an accumulator, updated from the pieces changed by the last move when the
+/// accumulator of the previous position is available. The following layers
+/// are small and are computed with int8 weights at each evaluation.
+
+namespace Eval {
+namespace NNUE {
+
+constexpr int HalfDimensions = 256;
+
+struct Accumulator {
+  int16_t accumulation[COLOR_NB][HalfDimensions];
+  bool computed;
+};
+
+/// DirtyPiece lists the pieces changed by a move, at most three when a pawn
+/// captures and promotes. A piece added to or removed from the board has its
+/// 'from' or 'to' square set to SQ_NONE.
+struct DirtyPiece {
+  int dirtyNum;
+  Piece piece[3];
+  Square from[3];
+  Square to[3];
+};
+
+bool load(const std::string& evalFile);
+Value evaluate(const Position& pos);
+
+} // namespace NNUE
+} // namespace Eval
+
+#endif // #ifndef NNUE_H_INCLUDED
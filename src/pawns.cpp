@@ -20,11 +20,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>   // For std::memcpy, std::memmove, std::memset
 
 #include "bitboard.h"
 #include "pawns.h"
 #include "position.h"
 #include "thread.h"
+#include "tune.h"
 
 namespace {
 
@@ -32,19 +34,19 @@ namespace {
   #define S(mg, eg) make_score(mg, eg)
 
   // Pawn penalties
-  constexpr Score Backward      = S( 9, 24);
-  constexpr Score BlockedStorm  = S(82, 82);
-  constexpr Score Doubled       = S(11, 56);
-  constexpr Score Isolated      = S( 5, 15);
-  constexpr Score WeakLever     = S( 0, 56);
-  constexpr Score WeakUnopposed = S(13, 27);
+  TUNABLE Score Backward      = S( 9, 24);
+  TUNABLE Score BlockedStorm  = S(82, 82);
+  TUNABLE Score Doubled       = S(11, 56);
+  TUNABLE Score Isolated      = S( 5, 15);
+  TUNABLE Score WeakLever     = S( 0, 56);
+  TUNABLE Score WeakUnopposed = S(13, 27);
 
   // Connected pawn bonus
-  constexpr int Connected[RANK_NB] = { 0, 7, 8, 12, 29, 48, 86 };
+  TUNABLE int Connected[RANK_NB] = { 0, 7, 8, 12, 29, 48, 86 };
 
   // Strength of pawn shelter for our king by [distance from edge][rank].
   // RANK_1 = 0 is used for files where we have no pawn, or pawn is behind our king.
-  constexpr Value ShelterStrength[int(FILE_NB) / 2][RANK_NB] = {
+  TUNABLE Value ShelterStrength[int(FILE_NB) / 2][RANK_NB] = {
     { V( -6), V( 81), V( 93), V( 58), V( 39), V( 18), V(  25) },
     { V(-43), V( 61), V( 35), V(-49), V(-29), V(-11), V( -63) },
     { V(-10), V( 75), V( 23), V( -2), V( 32), V(  3), V( -45) },
@@ -55,13 +57,21 @@ namespace {
   // RANK_1 = 0 is used for files where the enemy has no pawn, or their pawn
   // is behind our king. Note that UnblockedStorm[0][1-2] accommodate opponent pawn
   // on edge, likely blocked by our king.
-  constexpr Value UnblockedStorm[int(FILE_NB) / 2][RANK_NB] = {
+  TUNABLE Value UnblockedStorm[int(FILE_NB) / 2][RANK_NB] = {
     { V( 85), V(-289), V(-166), V(97), V(50), V( 45), V( 50) },
     { V( 46), V( -25), V( 122), V(45), V(37), V(-10), V( 20) },
     { V( -6), V(  51), V( 168), V(34), V(-2), V(-22), V(-14) },
     { V(-15), V( -11), V( 101), V( 4), V(11), V(-15), V(-29) }
   };
 
+#ifdef USE_TUNE
+  bool Registered = Tune::add({
+    TUNE_PARAM(Backward), TUNE_PARAM(BlockedStorm), TUNE_PARAM(Doubled), TUNE_PARAM(Isolated),
+    TUNE_PARAM(WeakLever), TUNE_PARAM(WeakUnopposed), TUNE_PARAM(Connected),
+    TUNE_PARAM(ShelterStrength), TUNE_PARAM(UnblockedStorm)
+  });
+#endif
+
   #undef S
   #undef V
 
@@ -76,7 +86,6 @@ namespace {
     Square s;
     bool backward, passed, doubled;
     Score score = SCORE_ZERO;
-    const Square* pl = pos.squares<PAWN>(Us);
 
     Bitboard ourPawns   = pos.pieces(  Us, PAWN);
     Bitboard theirPawns = pos.pieces(Them, PAWN);
@@ -87,8 +96,11 @@ namespace {
     e->pawnAttacks[Us] = e->pawnAttacksSpan[Us] = pawn_attacks_bb<Us>(ourPawns);
 
     // Loop through all pawns of the current color and score each pawn
-    while ((s = *pl++) != SQ_NONE)
+    Bitboard b = ourPawns;
+    while (b)
     {
+        s = pop_lsb(&b);
+
         assert(pos.piece_on(s) == make_piece(Us, PAWN));
 
         Rank r = relative_rank(Us, s);
@@ -153,10 +165,39 @@ namespace {
     return score;
   }
 
+  // compute() fills the entry of the pawn structure of the given key
+  void compute(const Position& pos, Pawns::Entry* e, Key key) {
+
+    e->key = key;
+    e->scores[WHITE] = evaluate<WHITE>(pos, e);
+    e->scores[BLACK] = evaluate<BLACK>(pos, e);
+
+    // Initialize all remaining entries
+    std::memset(e->kingSafety, 0, sizeof(e->kingSafety));
+    std::memset(e->kingSquares, SQ_NONE, sizeof(e->kingSquares));
+    std::memset(e->castlingRights, NO_CASTLING, sizeof(e->castlingRights));
+  }
+
+  // checksum() folds the content of an entry into 64 bits
+  uint64_t checksum(const Pawns::Entry& e) {
+
+    static_assert(sizeof(e) % sizeof(uint64_t) == 0, "Entry size not a multiple of 8");
+
+    uint64_t words[sizeof(e) / sizeof(uint64_t)], sum = 0;
+    std::memcpy(words, &e, sizeof(e));
+
+    for (uint64_t w : words)
+        sum ^= w;
+
+    return sum;
+  }
+
 } // namespace
 
 namespace Pawns {
 
+SharedTable Shared; // Global object
+
 /// Pawns::probe() looks up the current position's pawns configuration in
 /// the pawns hash table. It returns a pointer to the Entry if the position
 /// is found. Otherwise a new Entry is computed and stored there, so we don't
@@ -165,24 +206,89 @@ namespace Pawns {
 Entry* probe(const Position& pos) {
 
   Key key = pos.pawn_key();
-  Entry* e = pos.this_thread()->pawnsTable[key];
+  Thread* th = pos.this_thread();
+  Entry* e;
 
-  if (e->key == key)
+  // With the shared table the thread works on its own copy of the entry, kept
+  // until the pawn structure changes so that king safety is cached as well.
+  if (Shared.enabled())
+  {
+      e = &th->pawnsEntry;
+
+      if (e->key == key || Shared.probe(key, *e))
+          return e;
+
+      compute(pos, e, key);
+      Shared.save(*e);
       return e;
+  }
 
-  e->key = key;
-  e->scores[WHITE] = evaluate<WHITE>(pos, e);
-  e->scores[BLACK] = evaluate<BLACK>(pos, e);
+  e = th->pawnsTable[key];
 
-  // Initialize all remaining entries
-  e->kingSquares[WHITE] = e->kingSquares[BLACK] = SQ_NONE;
-  e->kingSafety[WHITE] = e->kingSafety[BLACK] = SCORE_ZERO;
-  e->castlingRights[WHITE] = e->castlingRights[BLACK] = NO_CASTLING;
+  if (e->key == key)
+      return e;
 
+  compute(pos, e, key);
   return e;
 }
 
 
+/// Table::resize() sets the size of the table to the largest power of two
+/// number of entries that fits in the given number of megabytes, and clears it.
+/// A zero size frees the table.
+
+void Table::resize(size_t mbSize) {
+
+  size_t count = mbSize * 1024 * 1024 / sizeof(Entry);
+
+  while (count & (count - 1))
+      count &= count - 1;
+
+  table.assign(count, Entry());
+  table.shrink_to_fit();
+}
+
+
+/// SharedTable::resize() works like Table::resize(). A zero size disables it.
+
+void SharedTable::resize(size_t mbSize) {
+
+  size_t count = mbSize * 1024 * 1024 / sizeof(Slot);
+
+  while (count & (count - 1))
+      count &= count - 1;
+
+  table.assign(count, Slot());
+  table.shrink_to_fit();
+}
+
+
+/// SharedTable::probe() copies the entry of the given key to 'e' and returns
+/// true if it is found with a valid checksum. Otherwise 'e' is left unchanged.
+
+bool SharedTable::probe(Key key, Entry& e) const {
+
+  Slot slot = table[size_t(key) & (table.size() - 1)];
+
+  if (slot.entry.key != key || slot.checksum != checksum(slot.entry))
+      return false;
+
+  e = slot.entry;
+  return true;
+}
+
+
+/// SharedTable::save() stores an entry, overwriting any previous one
+
+void SharedTable::save(const Entry& e) {
+
+  Slot& slot = table[size_t(e.key) & (table.size() - 1)];
+
+  slot.entry = e;
+  slot.checksum = checksum(e);
+}
+
+
 /// Entry::evaluate_shelter() calculates the shelter bonus and the storm
 /// penalty for a king, looking at the king file and the two closest files.
 
@@ -219,15 +325,16 @@ Score Entry::evaluate_shelter(const Position& pos, Square ksq) {
 }
 
 
-/// Entry::do_king_safety() calculates a bonus for king safety. It is called only
-/// when king square changes, which is about 20% of total king_safety() calls.
+/// Entry::do_king_safety() calculates a bonus for king safety and stores it in
+/// the first king slot. It is called only when the king square and castling
+/// rights are not in the slots, in about 16% of total king_safety() calls.
 
 template<Color Us>
 Score Entry::do_king_safety(const Position& pos) {
 
   Square ksq = pos.square<KING>(Us);
-  kingSquares[Us] = ksq;
-  castlingRights[Us] = pos.castling_rights(Us);
+
+  pos.this_thread()->stats.count(Search::KING_SAFETY_MISS);
 
   Score shelter = evaluate_shelter<Us>(pos, ksq);
 
@@ -257,7 +364,18 @@ Score Entry::do_king_safety(const Position& pos) {
   else while (pawns)
       minPawnDist = std::min(minPawnDist, distance(ksq, pop_lsb(&pawns)));
 
-  return shelter - make_score(0, 16 * minPawnDist);
+  Score score = shelter - make_score(0, 16 * minPawnDist);
+
+  // Evict the least recently computed slot
+  std::memmove(&kingSafety[Us][1], &kingSafety[Us][0], (KingSlots - 1) * sizeof(Score));
+  std::memmove(&kingSquares[Us][1], &kingSquares[Us][0], KingSlots - 1);
+  std::memmove(&castlingRights[Us][1], &castlingRights[Us][0], KingSlots - 1);
+
+  kingSafety[Us][0] = score;
+  kingSquares[Us][0] = uint8_t(ksq);
+  castlingRights[Us][0] = uint8_t(pos.castling_rights(Us));
+
+  return score;
 }
 
 // Explicit template instantiation
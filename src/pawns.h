@@ -21,6 +21,8 @@
 #ifndef PAWNS_H_INCLUDED
 #define PAWNS_H_INCLUDED
 
+#include <vector>
+
 #include "misc.h"
 #include "position.h"
 #include "types.h"
@@ -29,10 +31,14 @@ namespace Pawns {
 
 /// Pawns::Entry contains various information about a pawn structure. A lookup
 /// to the pawn hash table (performed by calling the probe function) returns a
-/// pointer to an Entry object.
+/// pointer to an Entry object. The king safety of each side is cached for the
+/// last KingSlots king squares and castling rights met with this structure, the
+/// most recent first, as the king often shuffles between a few squares.
 
 struct Entry {
 
+  static constexpr int KingSlots = 4;
+
   Score pawn_score(Color c) const { return scores[c]; }
   Bitboard pawn_attacks(Color c) const { return pawnAttacks[c]; }
   Bitboard passed_pawns(Color c) const { return passedPawns[c]; }
@@ -41,8 +47,15 @@ struct Entry {
 
   template<Color Us>
   Score king_safety(const Position& pos) {
-    return  kingSquares[Us] != pos.square<KING>(Us) || castlingRights[Us] != pos.castling_rights(Us)
-          ? (kingSafety[Us] = do_king_safety<Us>(pos)) : kingSafety[Us];
+
+    Square ksq = pos.square<KING>(Us);
+    int cr = pos.castling_rights(Us);
+
+    for (int i = 0; i < KingSlots; ++i)
+        if (kingSquares[Us][i] == ksq && castlingRights[Us][i] == cr)
+            return kingSafety[Us][i];
+
+    return do_king_safety<Us>(pos);
   }
 
   template<Color Us>
@@ -56,12 +69,50 @@ struct Entry {
   Bitboard passedPawns[COLOR_NB];
   Bitboard pawnAttacks[COLOR_NB];
   Bitboard pawnAttacksSpan[COLOR_NB];
-  Square kingSquares[COLOR_NB];
-  Score kingSafety[COLOR_NB];
-  int castlingRights[COLOR_NB];
+  Score kingSafety[COLOR_NB][KingSlots];
+  uint8_t kingSquares[COLOR_NB][KingSlots];
+  uint8_t castlingRights[COLOR_NB][KingSlots];
+};
+
+/// Pawns::Table is the pawn hash table of a thread, its size is a power of two
+/// number of entries set by the 'Pawn Hash' UCI option. The default size holds
+/// DefaultEntries entries.
+
+constexpr size_t DefaultEntries = 131072;
+
+class Table {
+public:
+  Entry* operator[](Key key) { return &table[size_t(key) & (table.size() - 1)]; }
+  void resize(size_t mbSize);
+
+private:
+  std::vector<Entry> table;
+};
+
+/// Pawns::SharedTable is used instead of the per thread tables when the 'Shared
+/// Pawn Hash' option is set. It is accessed without locks, so an entry may be
+/// written by a thread while another one reads it. Each entry is stored with a
+/// checksum of its content, and probe() copies it out and verifies it before
+/// returning a hit.
+
+class SharedTable {
+
+  struct Slot {
+    Entry entry;
+    uint64_t checksum;
+  };
+
+public:
+  bool enabled() const { return !table.empty(); }
+  bool probe(Key key, Entry& e) const;
+  void save(const Entry& e);
+  void resize(size_t mbSize);
+
+private:
+  std::vector<Slot> table;
 };
 
-typedef HashTable<Entry, 131072> Table;
+extern SharedTable Shared;
 
 Entry* probe(const Position& pos);
 
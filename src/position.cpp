@@ -176,7 +176,6 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
 
   std::memset(this, 0, sizeof(Position));
   std::memset(si, 0, sizeof(StateInfo));
-  std::fill_n(&pieceList[0][0], sizeof(pieceList) / sizeof(Square), SQ_NONE);
   st = si;
 
   ss >> std::noskipws;
@@ -254,6 +253,14 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
   thisThread = th;
   set_state(st);
 
+#ifdef USE_INCREMENTAL_ATTACKS
+  for (Bitboard b = pieces(); b; )
+  {
+      Square s = pop_lsb(&b);
+      pieceAttacks[s] = compute_piece_attacks(s);
+  }
+#endif
+
   assert(pos_is_ok());
 
   return *this;
@@ -281,10 +288,15 @@ void Position::set_castling_right(Color c, Square rfrom) {
 }
 
 
-/// Position::set_check_info() sets king attacks to detect if a move gives check
+/// Position::set_check_info() sets king attacks to detect if a move gives check.
+/// It is called eagerly only when a position is set up or a null move is made,
+/// do_move() leaves it to the first check related query, see check_info(), so
+/// that nodes cut off before generating or evaluating anything skip the cost.
 
 void Position::set_check_info(StateInfo* si) const {
 
+  si->checkInfoValid = true;
+
   si->blockersForKing[WHITE] = slider_blockers(pieces(BLACK), square<KING>(WHITE), si->pinners[BLACK]);
   si->blockersForKing[BLACK] = slider_blockers(pieces(WHITE), square<KING>(BLACK), si->pinners[WHITE]);
 
@@ -608,7 +620,7 @@ bool Position::gives_check(Move m) const {
   Square to = to_sq(m);
 
   // Is there a direct check?
-  if (st->checkSquares[type_of(piece_on(from))] & to)
+  if (check_info()->checkSquares[type_of(piece_on(from))] & to)
       return true;
 
   // Is there a discovered check?
@@ -655,15 +667,17 @@ bool Position::gives_check(Move m) const {
 
 /// Position::do_move() makes a move, and saves all information necessary
 /// to a StateInfo object. The move is assumed to be legal. Pseudo-legal
-/// moves should be filtered out before this function is called.
+/// moves should be filtered out before this function is called. The key
+/// of the new position is given by the caller, as computed by key_after().
 
-void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
+void Position::do_move(Move m, StateInfo& newSt, bool givesCheck, Key newKey) {
 
   assert(is_ok(m));
   assert(&newSt != st);
 
+  assert(newKey == key_after(m));
+
   thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
-  Key k = st->key ^ Zobrist::side;
 
   // Copy some fields of the old state to our new StateInfo object except the
   // ones which are going to be recalculated from scratch anyway and then switch
@@ -672,6 +686,10 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   newSt.previous = st;
   st = &newSt;
 
+#ifdef USE_COPY_MAKE
+  std::memcpy(&st->board, static_cast<Board*>(this), sizeof(Board));
+#endif
+
   // Increment ply counters. In particular, rule50 will be reset to zero later on
   // in case of a capture or a pawn move.
   ++gamePly;
@@ -689,6 +707,15 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   assert(captured == NO_PIECE || color_of(captured) == (type_of(m) != CASTLING ? them : us));
   assert(type_of(captured) != KING);
 
+  Bitboard changed = square_bb(from) | to; // Squares whose piece changes
+
+  // Pieces changed by the move, for the NNUE accumulator update
+  Eval::NNUE::DirtyPiece& dp = st->dirtyPiece;
+  st->accumulator.computed = false;
+  dp.dirtyNum = 1;
+  dp.piece[0] = pc;
+  dp.from[0] = from;
+
   if (type_of(m) == CASTLING)
   {
       assert(pc == make_piece(us, KING));
@@ -696,8 +723,12 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
 
       Square rfrom, rto;
       do_castling<true>(us, from, to, rfrom, rto);
+      changed |= square_bb(to) | rfrom | rto;
 
-      k ^= Zobrist::psq[captured][rfrom] ^ Zobrist::psq[captured][rto];
+      dp.dirtyNum = 2;
+      dp.piece[1] = captured;
+      dp.from[1] = rfrom;
+      dp.to[1] = rto;
       captured = NO_PIECE;
   }
 
@@ -720,6 +751,7 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
               assert(piece_on(capsq) == make_piece(them, PAWN));
 
               board[capsq] = NO_PIECE; // Not done by remove_piece()
+              changed |= capsq;
           }
 
           st->pawnKey ^= Zobrist::psq[captured][capsq];
@@ -727,36 +759,29 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
       else
           st->nonPawnMaterial[them] -= PieceValue[MG][captured];
 
-      // Update board and piece lists
+      // Update board and piece counts
       remove_piece(captured, capsq);
 
-      // Update material hash key and prefetch access to materialTable
-      k ^= Zobrist::psq[captured][capsq];
-      st->materialKey ^= Zobrist::psq[captured][pieceCount[captured]];
+      dp.dirtyNum = 2;
+      dp.piece[1] = captured;
+      dp.from[1] = capsq;
+      dp.to[1] = SQ_NONE;
 
-      prefetch(thisThread->materialTable[st->materialKey]);
+      // Update material hash key
+      st->materialKey ^= Zobrist::psq[captured][pieceCount[captured]];
 
       // Reset rule 50 counter
       st->rule50 = 0;
   }
 
-  // Update hash key
-  k ^= Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to];
+  dp.to[0] = to;
 
   // Reset en passant square
-  if (st->epSquare != SQ_NONE)
-  {
-      k ^= Zobrist::enpassant[file_of(st->epSquare)];
-      st->epSquare = SQ_NONE;
-  }
+  st->epSquare = SQ_NONE;
 
   // Update castling rights if needed
   if (st->castlingRights && (castlingRightsMask[from] | castlingRightsMask[to]))
-  {
-      int cr = castlingRightsMask[from] | castlingRightsMask[to];
-      k ^= Zobrist::castling[st->castlingRights & cr];
-      st->castlingRights &= ~cr;
-  }
+      st->castlingRights &= ~(castlingRightsMask[from] | castlingRightsMask[to]);
 
   // Move the piece. The tricky Chess960 castling is handled earlier
   if (type_of(m) != CASTLING)
@@ -768,10 +793,7 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
       // Set en-passant square if the moved pawn can be captured
       if (   (int(to) ^ int(from)) == 16
           && (attacks_from<PAWN>(to - pawn_push(us), us) & pieces(them, PAWN)))
-      {
           st->epSquare = to - pawn_push(us);
-          k ^= Zobrist::enpassant[file_of(st->epSquare)];
-      }
 
       else if (type_of(m) == PROMOTION)
       {
@@ -783,14 +805,17 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
           remove_piece(pc, to);
           put_piece(promotion, to);
 
+          dp.to[0] = SQ_NONE;
+          dp.piece[dp.dirtyNum] = promotion;
+          dp.from[dp.dirtyNum] = SQ_NONE;
+          dp.to[dp.dirtyNum] = to;
+          dp.dirtyNum++;
+
           // Update hash keys
-          k ^= Zobrist::psq[pc][to] ^ Zobrist::psq[promotion][to];
           st->pawnKey ^= Zobrist::psq[pc][to];
           st->materialKey ^=  Zobrist::psq[promotion][pieceCount[promotion]-1]
                             ^ Zobrist::psq[pc][pieceCount[pc]];
 
-          prefetch(thisThread->materialTable[st->materialKey]);
-
           // Update material
           st->nonPawnMaterial[us] += PieceValue[MG][promotion];
       }
@@ -805,16 +830,31 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   // Set capture piece
   st->capturedPiece = captured;
 
-  // Update the key with the final value
-  st->key = k;
+  // Set the key, computed by key_after() before the move
+  st->key = newKey;
 
   // Calculate checkers bitboard (if move gives check)
+#ifdef USE_INCREMENTAL_ATTACKS
+  update_piece_attacks(changed);
+
+  // Only the moved piece or a slider can give check
+  st->checkersBB = 0;
+
+  if (givesCheck)
+      for (Bitboard b = pieces(us, BISHOP, ROOK) | pieces(us, QUEEN) | to; b; )
+      {
+          Square s = pop_lsb(&b);
+          if (pieceAttacks[s] & square<KING>(them))
+              st->checkersBB |= s;
+      }
+#else
   st->checkersBB = givesCheck ? attackers_to(square<KING>(them)) & pieces(us) : 0;
+#endif
 
   sideToMove = ~sideToMove;
 
-  // Update king attacks used for fast check detection
-  set_check_info(st);
+  // King attacks used for fast check detection are computed on demand
+  st->checkInfoValid = false;
 
   // Calculate the repetition info. It is the ply distance from the previous
   // occurrence of the same position, negative in the 3-fold case, or zero
@@ -851,6 +891,16 @@ void Position::undo_move(Move m) {
 
   sideToMove = ~sideToMove;
 
+#ifdef USE_COPY_MAKE
+  // Discard the board and take the one saved by do_move()
+  std::memcpy(static_cast<Board*>(this), &st->board, sizeof(Board));
+  st = st->previous;
+  --gamePly;
+
+  assert(pos_is_ok());
+  return;
+#endif
+
   Color us = sideToMove;
   Square from = from_sq(m);
   Square to = to_sq(m);
@@ -859,6 +909,8 @@ void Position::undo_move(Move m) {
   assert(empty(from) || type_of(m) == CASTLING);
   assert(type_of(st->capturedPiece) != KING);
 
+  Bitboard changed = square_bb(from) | to;
+
   if (type_of(m) == PROMOTION)
   {
       assert(relative_rank(us, to) == RANK_8);
@@ -874,6 +926,7 @@ void Position::undo_move(Move m) {
   {
       Square rfrom, rto;
       do_castling<false>(us, from, to, rfrom, rto);
+      changed |= square_bb(to) | rfrom | rto;
   }
   else
   {
@@ -895,9 +948,14 @@ void Position::undo_move(Move m) {
           }
 
           put_piece(st->capturedPiece, capsq); // Restore the captured piece
+          changed |= capsq;
       }
   }
 
+#ifdef USE_INCREMENTAL_ATTACKS
+  update_piece_attacks(changed);
+#endif
+
   // Finally point our state pointer back to the previous state
   st = st->previous;
   --gamePly;
@@ -925,6 +983,46 @@ void Position::do_castling(Color us, Square from, Square& to, Square& rfrom, Squ
 }
 
 
+#ifdef USE_INCREMENTAL_ATTACKS
+
+/// Position::compute_piece_attacks() returns the squares attacked by the piece
+/// on the given square, none if the square is empty.
+
+Bitboard Position::compute_piece_attacks(Square s) const {
+
+  Piece pc = piece_on(s);
+
+  return  pc == NO_PIECE       ? Bitboard(0)
+        : type_of(pc) == PAWN  ? attacks_from<PAWN>(s, color_of(pc))
+                               : attacks_from(type_of(pc), s);
+}
+
+
+/// Position::update_piece_attacks() updates pieceAttacks[] after the pieces on
+/// the 'changed' squares have been moved, captured or put back. Besides those
+/// squares, only the sliders that were attacking one of them can see a change.
+
+void Position::update_piece_attacks(Bitboard changed) {
+
+  Bitboard sliders = (pieces(BISHOP, ROOK) | pieces(QUEEN)) & ~changed;
+
+  while (sliders)
+  {
+      Square s = pop_lsb(&sliders);
+      if (pieceAttacks[s] & changed)
+          pieceAttacks[s] = attacks_from(type_of(piece_on(s)), s);
+  }
+
+  while (changed)
+  {
+      Square s = pop_lsb(&changed);
+      pieceAttacks[s] = compute_piece_attacks(s);
+  }
+}
+
+#endif
+
+
 /// Position::do(undo)_null_move() is used to do(undo) a "null move": it flips
 /// the side to move without executing any move on the board.
 
@@ -935,10 +1033,14 @@ void Position::do_null_move(StateInfo& newSt) {
 
   thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
 
-  std::memcpy(&newSt, st, sizeof(StateInfo));
+  std::memcpy(&newSt, st, offsetof(StateInfo, accumulator));
   newSt.previous = st;
   st = &newSt;
 
+  // The NNUE accumulator is copied from the previous state when needed
+  st->dirtyPiece.dirtyNum = 0;
+  st->accumulator.computed = false;
+
   if (st->epSquare != SQ_NONE)
   {
       st->key ^= Zobrist::enpassant[file_of(st->epSquare)];
@@ -969,22 +1071,49 @@ void Position::undo_null_move() {
 }
 
 
-/// Position::key_after() computes the new hash key after the given move. Needed
-/// for speculative prefetch. It doesn't recognize special moves like castling,
-/// en-passant and promotions.
+/// Position::key_after() computes the hash key after the given move, special
+/// moves included. It is used by do_move() and for the speculative prefetch of
+/// the TT entry, that is then exact.
 
 Key Position::key_after(Move m) const {
 
+  Color us = sideToMove;
   Square from = from_sq(m);
   Square to = to_sq(m);
   Piece pc = piece_on(from);
-  Piece captured = piece_on(to);
   Key k = st->key ^ Zobrist::side;
 
-  if (captured)
-      k ^= Zobrist::psq[captured][to];
+  if (st->epSquare != SQ_NONE)
+      k ^= Zobrist::enpassant[file_of(st->epSquare)];
+
+  if (st->castlingRights && (castlingRightsMask[from] | castlingRightsMask[to]))
+      k ^= Zobrist::castling[st->castlingRights & (castlingRightsMask[from] | castlingRightsMask[to])];
+
+  if (type_of(m) == CASTLING)
+  {
+      Piece rook = piece_on(to);
+      Square rto = relative_square(us, to > from ? SQ_F1 : SQ_D1);
+      Square kto = relative_square(us, to > from ? SQ_G1 : SQ_C1);
+
+      return k ^ Zobrist::psq[pc][from] ^ Zobrist::psq[pc][kto]
+               ^ Zobrist::psq[rook][to] ^ Zobrist::psq[rook][rto];
+  }
 
-  return k ^ Zobrist::psq[pc][to] ^ Zobrist::psq[pc][from];
+  if (type_of(m) == ENPASSANT)
+      k ^= Zobrist::psq[make_piece(~us, PAWN)][to - pawn_push(us)];
+
+  else if (piece_on(to))
+      k ^= Zobrist::psq[piece_on(to)][to];
+
+  k ^= Zobrist::psq[pc][from] ^ Zobrist::psq[type_of(m) == PROMOTION ? make_piece(us, promotion_type(m)) : pc][to];
+
+  // The en passant square is set only if the pushed pawn can be captured
+  if (   type_of(pc) == PAWN
+      && (int(to) ^ int(from)) == 16
+      && (attacks_from<PAWN>(to - pawn_push(us), us) & pieces(~us, PAWN)))
+      k ^= Zobrist::enpassant[file_of(to)];
+
+  return k;
 }
 
 
@@ -1050,7 +1179,7 @@ bool Position::see_ge(Move m, Value threshold) const {
 
       // Don't allow pinned pieces to attack (except the king)
       // as long as any pinners are on their original square.
-      if (st->pinners[~stm] & occupied)
+      if (check_info()->pinners[~stm] & occupied)
           stmAttackers &= ~st->blockersForKing[stm];
 
       // 2nd check
@@ -1219,22 +1348,23 @@ bool Position::pos_is_ok() const {
           if (p1 != p2 && (pieces(p1) & pieces(p2)))
               assert(0 && "pos_is_ok: Bitboards");
 
+#ifdef USE_INCREMENTAL_ATTACKS
+  for (Square s = SQ_A1; s <= SQ_H8; ++s)
+      if (pieceAttacks[s] != compute_piece_attacks(s))
+          assert(0 && "pos_is_ok: Piece attacks");
+#endif
+
+  check_info();
   StateInfo si = *st;
   set_state(&si);
   if (std::memcmp(&si, st, sizeof(StateInfo)))
       assert(0 && "pos_is_ok: State");
 
   for (Piece pc : Pieces)
-  {
       if (   pieceCount[pc] != popcount(pieces(color_of(pc), type_of(pc)))
           || pieceCount[pc] != std::count(board, board + SQUARE_NB, pc))
           assert(0 && "pos_is_ok: Pieces");
 
-      for (int i = 0; i < pieceCount[pc]; ++i)
-          if (board[pieceList[pc][i]] != pc || index[pieceList[pc][i]] != i)
-              assert(0 && "pos_is_ok: Index");
-  }
-
   for (Color c : { WHITE, BLACK })
       for (CastlingRights cr : {c & KING_SIDE, c & QUEEN_SIDE})
       {
@@ -27,9 +27,28 @@
 #include <string>
 
 #include "bitboard.h"
+#include "nnue.h"
 #include "types.h"
 
 
+/// Board is the placement of the pieces, the part of a Position changed by
+/// do_move().
+
+struct Board {
+  Piece board[SQUARE_NB];
+  Bitboard byTypeBB[PIECE_TYPE_NB];
+  Bitboard byColorBB[COLOR_NB];
+  int pieceCount[PIECE_NB];
+  Score psq[COLOR_NB];
+#ifdef USE_INCREMENTAL_ATTACKS
+  // With 'make incattacks=yes' the attacks of every piece are kept up to date
+  // in do_move() and undo_move(), so that they are not computed again by the
+  // evaluation and the check detection.
+  Bitboard pieceAttacks[SQUARE_NB];
+#endif
+};
+
+
 /// StateInfo struct stores information needed to restore a Position object to
 /// its previous state when we retract a move. Whenever a move is made on the
 /// board (by calling Position::do_move), a StateInfo object must be passed.
@@ -54,6 +73,17 @@ struct StateInfo {
   Bitboard   pinners[COLOR_NB];
   Bitboard   checkSquares[PIECE_TYPE_NB];
   int        repetition;
+  bool       checkInfoValid; // Check info is computed on first use
+
+  // Used by the NNUE evaluation only, not copied by do_null_move() otherwise
+  Eval::NNUE::DirtyPiece  dirtyPiece;
+  Eval::NNUE::Accumulator accumulator;
+
+#ifdef USE_COPY_MAKE
+  // With 'make copymake=yes' do_move() saves the board before the move here and
+  // undo_move() copies it back, instead of taking the move back piece by piece.
+  Board board;
+#endif
 };
 
 /// A list to keep track of the position states along the setup moves (from the
@@ -69,7 +99,7 @@ typedef std::unique_ptr<std::deque<StateInfo>> StateListPtr;
 /// traversing the search tree.
 class Thread;
 
-class Position {
+class Position : private Board {
 public:
   static void init();
 
@@ -91,7 +121,6 @@ public:
   Square ep_square() const;
   bool empty(Square s) const;
   template<PieceType Pt> int count(Color c = COLOR_NB) const;
-  template<PieceType Pt> const Square* squares(Color c) const;
   template<PieceType Pt> Square square(Color c) const;
   bool is_on_semiopen_file(Color c, Square s) const;
 
@@ -110,6 +139,9 @@ public:
   // Attacks to/from a given square
   Bitboard attackers_to(Square s) const;
   Bitboard attackers_to(Square s, Bitboard occupied) const;
+#ifdef USE_INCREMENTAL_ATTACKS
+  Bitboard piece_attacks(Square s) const;
+#endif
   Bitboard attacks_from(PieceType pt, Square s) const;
   template<PieceType> Bitboard attacks_from(Square s) const;
   template<PieceType> Bitboard attacks_from(Square s, Color c) const;
@@ -134,6 +166,7 @@ public:
   // Doing and undoing moves
   void do_move(Move m, StateInfo& newSt);
   void do_move(Move m, StateInfo& newSt, bool givesCheck);
+  void do_move(Move m, StateInfo& newSt, bool givesCheck, Key newKey);
   void undo_move(Move m);
   void do_null_move(StateInfo& newSt);
   void undo_null_move();
@@ -152,6 +185,7 @@ public:
   int game_ply() const;
   bool is_chess960() const;
   Thread* this_thread() const;
+  StateInfo* state() const;
   bool is_draw(int ply) const;
   bool has_repeated() const;
   int rule50_count() const;
@@ -167,6 +201,7 @@ private:
   void set_castling_right(Color c, Square rfrom);
   void set_state(StateInfo* si) const;
   void set_check_info(StateInfo* si) const;
+  const StateInfo* check_info() const;
 
   // Other helpers
   void put_piece(Piece pc, Square s);
@@ -174,20 +209,17 @@ private:
   void move_piece(Piece pc, Square from, Square to);
   template<bool Do>
   void do_castling(Color us, Square from, Square& to, Square& rfrom, Square& rto);
+#ifdef USE_INCREMENTAL_ATTACKS
+  Bitboard compute_piece_attacks(Square s) const;
+  void update_piece_attacks(Bitboard changed);
+#endif
 
-  // Data members
-  Piece board[SQUARE_NB];
-  Bitboard byTypeBB[PIECE_TYPE_NB];
-  Bitboard byColorBB[COLOR_NB];
-  int pieceCount[PIECE_NB];
-  Square pieceList[PIECE_NB][16];
-  int index[SQUARE_NB];
+  // Data members, after those of Board
   int castlingRightsMask[SQUARE_NB];
   Square castlingRookSquare[CASTLING_RIGHT_NB];
   Bitboard castlingPath[CASTLING_RIGHT_NB];
   int gamePly;
   Color sideToMove;
-  Score psq[COLOR_NB];
   Thread* thisThread;
   StateInfo* st;
   bool chess960;
@@ -237,13 +269,9 @@ template<PieceType Pt> inline int Position::count(Color c) const {
                       : pieceCount[make_piece(WHITE, Pt)] + pieceCount[make_piece(BLACK, Pt)];
 }
 
-template<PieceType Pt> inline const Square* Position::squares(Color c) const {
-  return pieceList[make_piece(c, Pt)];
-}
-
 template<PieceType Pt> inline Square Position::square(Color c) const {
   assert(pieceCount[make_piece(c, Pt)] == 1);
-  return pieceList[make_piece(c, Pt)][0];
+  return lsb(pieces(c, Pt));
 }
 
 inline Square Position::ep_square() const {
@@ -294,20 +322,32 @@ inline Bitboard Position::attackers_to(Square s) const {
   return attackers_to(s, byTypeBB[ALL_PIECES]);
 }
 
+#ifdef USE_INCREMENTAL_ATTACKS
+inline Bitboard Position::piece_attacks(Square s) const {
+  return pieceAttacks[s];
+}
+#endif
+
 inline Bitboard Position::checkers() const {
   return st->checkersBB;
 }
 
+inline const StateInfo* Position::check_info() const {
+  if (!st->checkInfoValid)
+      set_check_info(st);
+  return st;
+}
+
 inline Bitboard Position::blockers_for_king(Color c) const {
-  return st->blockersForKing[c];
+  return check_info()->blockersForKing[c];
 }
 
 inline Bitboard Position::check_squares(PieceType pt) const {
-  return st->checkSquares[pt];
+  return check_info()->checkSquares[pt];
 }
 
 inline bool Position::is_discovery_check_on_king(Color c, Move m) const {
-  return st->blockersForKing[c] & from_sq(m);
+  return check_info()->blockersForKing[c] & from_sq(m);
 }
 
 inline bool Position::pawn_passed(Color c, Square s) const {
@@ -388,53 +428,49 @@ inline Thread* Position::this_thread() const {
   return thisThread;
 }
 
+inline StateInfo* Position::state() const {
+  return st;
+}
+
 inline void Position::put_piece(Piece pc, Square s) {
 
   board[s] = pc;
   byTypeBB[ALL_PIECES] |= s;
   byTypeBB[type_of(pc)] |= s;
   byColorBB[color_of(pc)] |= s;
-  index[s] = pieceCount[pc]++;
-  pieceList[pc][index[s]] = s;
+  pieceCount[pc]++;
   pieceCount[make_piece(color_of(pc), ALL_PIECES)]++;
   psq[color_of(pc)] += PSQT::psq[pc][s];
 }
 
 inline void Position::remove_piece(Piece pc, Square s) {
 
-  // WARNING: This is not a reversible operation. If we remove a piece in
-  // do_move() and then replace it in undo_move() we will put it at the end of
-  // the list and not in its original place, it means index[] and pieceList[]
-  // are not invariant to a do_move() + undo_move() sequence.
   byTypeBB[ALL_PIECES] ^= s;
   byTypeBB[type_of(pc)] ^= s;
   byColorBB[color_of(pc)] ^= s;
   /* board[s] = NO_PIECE;  Not needed, overwritten by the capturing one */
-  Square lastSquare = pieceList[pc][--pieceCount[pc]];
-  index[lastSquare] = index[s];
-  pieceList[pc][index[lastSquare]] = lastSquare;
-  pieceList[pc][pieceCount[pc]] = SQ_NONE;
+  pieceCount[pc]--;
   pieceCount[make_piece(color_of(pc), ALL_PIECES)]--;
   psq[color_of(pc)] -= PSQT::psq[pc][s];
 }
 
 inline void Position::move_piece(Piece pc, Square from, Square to) {
 
-  // index[from] is not updated and becomes stale. This works as long as index[]
-  // is accessed just by known occupied squares.
   Bitboard fromTo = square_bb(from) | square_bb(to);
   byTypeBB[ALL_PIECES] ^= fromTo;
   byTypeBB[type_of(pc)] ^= fromTo;
   byColorBB[color_of(pc)] ^= fromTo;
   board[from] = NO_PIECE;
   board[to] = pc;
-  index[to] = index[from];
-  pieceList[pc][index[to]] = to;
   psq[color_of(pc)] += PSQT::psq[pc][to] - PSQT::psq[pc][from];
 }
 
 inline void Position::do_move(Move m, StateInfo& newSt) {
-  do_move(m, newSt, gives_check(m));
+  do_move(m, newSt, gives_check(m), key_after(m));
+}
+
+inline void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
+  do_move(m, newSt, givesCheck, key_after(m));
 }
 
 #endif // #ifndef POSITION_H_INCLUDED
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 
+#include "tune.h"
 #include "types.h"
 
 namespace PSQT {
@@ -30,7 +31,7 @@ namespace PSQT {
 // type on a given square a (middlegame, endgame) score pair is assigned. Table
 // is defined for files A..D and white side: it is symmetric for black side and
 // second half of the files.
-constexpr Score Bonus[][RANK_NB][int(FILE_NB) / 2] = {
+TUNABLE Score Bonus[][RANK_NB][int(FILE_NB) / 2] = {
   { },
   { },
   { // Knight
@@ -85,7 +86,7 @@ constexpr Score Bonus[][RANK_NB][int(FILE_NB) / 2] = {
   }
 };
 
-constexpr Score PawnBonus[RANK_NB][FILE_NB] =
+TUNABLE Score PawnBonus[RANK_NB][FILE_NB] =
   { // Pawn (asymmetric distribution)
    { },
    { S(  3,-10), S(  3, -6), S( 10, 10), S( 19,  0), S( 16, 14), S( 19,  7), S(  7, -5), S( -5,-19) },
@@ -96,6 +97,10 @@ constexpr Score PawnBonus[RANK_NB][FILE_NB] =
    { S( -7,  0), S(  7,-11), S( -3, 12), S(-13, 21), S(  5, 25), S(-16, 19), S( 10,  4), S( -8,  7) }
   };
 
+#ifdef USE_TUNE
+namespace { bool Registered = Tune::add({ TUNE_PARAM(Bonus), TUNE_PARAM(PawnBonus) }); }
+#endif
+
 #undef S
 
 Score psq[PIECE_NB][SQUARE_NB];
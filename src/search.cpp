@@ -19,9 +19,11 @@
 */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstring>   // For std::memset
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -31,6 +33,7 @@
 #include "movepick.h"
 #include "position.h"
 #include "search.h"
+#include "searchlog.h"
 #include "thread.h"
 #include "timeman.h"
 #include "tt.h"
@@ -144,39 +147,123 @@ namespace {
   template <NodeType NT>
   Value qsearch(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth = 0);
 
+  template <NodeType NT>
+  Value search_node(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
+
+  template <NodeType NT>
+  Value qsearch_node(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth);
+
+  Value cached_evaluate(const Position& pos);
   Value value_to_tt(Value v, int ply);
   Value value_from_tt(Value v, int ply);
   void update_continuation_histories(Stack* ss, Piece pc, Square to, int bonus);
   void update_quiet_stats(const Position& pos, Stack* ss, Move move, Move* quiets, int quietCount, int bonus);
   void update_capture_stats(const Position& pos, Move move, Move* captures, int captureCount, int bonus);
 
+  // PerftTable caches the leaf counts of the perft subtrees. It is shared by
+  // the threads without locking: the key is stored xored with the data, so
+  // that an entry torn by a concurrent write does not match any more.
+  class PerftTable {
+
+    struct Entry {
+      uint64_t keyXorData;
+      uint64_t data; // Leaf count in the upper 56 bits, depth in the lower 8
+    };
+
+  public:
+    void resize(size_t mbSize) {
+
+      size_t count = mbSize * 1024 * 1024 / sizeof(Entry);
+
+      while (count & (count - 1))
+          count &= count - 1;
+
+      table.assign(count, Entry());
+      table.shrink_to_fit();
+    }
+
+    bool probe(Key key, Depth depth, uint64_t& nodes) const {
+
+      if (table.empty())
+          return false;
+
+      const Entry& e = table[key & (table.size() - 1)];
+      uint64_t data = e.data;
+
+      if ((e.keyXorData ^ data) != key || int(data & 0xFF) != depth)
+          return false;
+
+      nodes = data >> 8;
+      return true;
+    }
+
+    void save(Key key, Depth depth, uint64_t nodes) {
+
+      if (table.empty())
+          return;
+
+      Entry& e = table[key & (table.size() - 1)];
+      e.data = nodes << 8 | uint64_t(depth);
+      e.keyXorData = key ^ e.data;
+    }
+
+  private:
+    std::vector<Entry> table;
+  };
+
+  PerftTable PerftTT;
+
+  // The root moves of a perft run are handed out to the threads one at a time,
+  // the leaf count of each one is stored at the same index.
+  std::vector<Move> PerftMoves;
+  std::vector<uint64_t> PerftCounts;
+  std::atomic<size_t> PerftNext;
+
   // perft() is our utility to verify move generation. All the leaf nodes up
   // to the given depth are generated and counted, and the sum is returned.
-  template<bool Root>
+  // The moves of the last ply are only counted, not made.
   uint64_t perft(Position& pos, Depth depth) {
 
+    if (depth == 1)
+        return MoveList<LEGAL>(pos).size();
+
     StateInfo st;
-    uint64_t cnt, nodes = 0;
-    const bool leaf = (depth == 2);
+    uint64_t nodes = 0;
+
+    if (PerftTT.probe(pos.key(), depth, nodes))
+        return nodes;
 
     for (const auto& m : MoveList<LEGAL>(pos))
     {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
-        else
-        {
-            pos.do_move(m, st);
-            cnt = leaf ? MoveList<LEGAL>(pos).size() : perft<false>(pos, depth - 1);
-            nodes += cnt;
-            pos.undo_move(m);
-        }
-        if (Root)
-            sync_cout << UCI::move(m, pos.is_chess960()) << ": " << cnt << sync_endl;
+        pos.do_move(m, st);
+        nodes += perft(pos, depth - 1);
+        pos.undo_move(m);
     }
 
+    PerftTT.save(pos.key(), depth, nodes);
     return nodes;
   }
 
+  // perft_root_moves() is run by all the threads of a perft run, each one on
+  // its own copy of the root position, until all the root moves are counted.
+  void perft_root_moves(Position& pos, Depth depth) {
+
+    StateInfo st;
+
+    for (size_t i; (i = PerftNext++) < PerftMoves.size(); )
+    {
+        if (depth <= 1)
+        {
+            PerftCounts[i] = 1;
+            continue;
+        }
+
+        pos.do_move(PerftMoves[i], st);
+        PerftCounts[i] = perft(pos, depth - 1);
+        pos.undo_move(PerftMoves[i]);
+    }
+  }
+
 } // namespace
 
 
@@ -197,11 +284,29 @@ void Search::clear() {
 
   Time.availableNodes = 0;
   TT.clear();
+  EvalHash.clear();
   Threads.clear();
   Tablebases::init(Options["SyzygyPath"]); // Free mapped files
 }
 
 
+/// Search::print_stats() sums up the search tree statistics of all the threads
+/// and writes them to stderr as a JSON object. Only builds done with
+/// 'make stats=yes' collect them, otherwise nothing is printed.
+
+void Search::print_stats() {
+
+  StatsCollector total;
+  total.clear();
+
+  for (Thread* th : Threads)
+      total += th->stats;
+
+  if (CollectStats)
+      std::cerr << total.to_json(Threads.size()) << std::endl;
+}
+
+
 /// MainThread::search() is started when the program receives the UCI 'go'
 /// command. It searches from the root position and outputs the "bestmove".
 
@@ -209,9 +314,45 @@ void MainThread::search() {
 
   if (Limits.perft)
   {
-      nodes = perft<true>(rootPos, Limits.perft);
-      sync_cout << "\nNodes searched: " << nodes << "\n" << sync_endl;
+      PerftTT.resize(Options["Perft Hash"]);
+      PerftMoves.clear();
+      PerftNext = 0;
+
+      for (const auto& m : MoveList<LEGAL>(rootPos))
+          PerftMoves.push_back(m);
+
+      PerftCounts.assign(PerftMoves.size(), 0);
 
+      for (Thread* th : Threads)
+          if (th != this)
+              th->start_searching();
+
+      perft_root_moves(rootPos, Limits.perft);
+
+      for (Thread* th : Threads)
+          if (th != this)
+              th->wait_for_search_finished();
+
+      nodes = 0;
+      TimePoint elapsed = now() - Limits.startTime + 1;
+
+      for (size_t i = 0; i < PerftMoves.size(); ++i)
+      {
+          nodes += PerftCounts[i];
+
+          if (Limits.divide)
+              sync_cout << UCI::move(PerftMoves[i], rootPos.is_chess960()) << ": "
+                        << PerftCounts[i] << sync_endl;
+      }
+
+      std::stringstream mnps;
+      mnps << std::fixed << std::setprecision(1) << double(nodes) / elapsed / 1000;
+
+      sync_cout << "\nNodes searched: " << nodes
+                << "\nTime (ms)     : " << elapsed
+                << "\nMnps          : " << mnps.str() << "\n" << sync_endl;
+
+      PerftTT.resize(0);
       return;
   }
 
@@ -235,10 +376,12 @@ void MainThread::search() {
       if (TB::RootInTB)
           tbHits = rootMoves.size();
 
-      // Wake up the helper threads
-      for (Thread* th : Threads)
-          if (th != this)
-              th->start_searching();
+      // Wake up the helper threads. In deterministic mode the main thread
+      // searches alone, so that the result depends only on the node count.
+      if (!Limits.deterministic)
+          for (Thread* th : Threads)
+              if (th != this)
+                  th->start_searching();
 
       Thread::search(); // Let's start searching!
   }
@@ -317,6 +460,13 @@ void MainThread::search() {
 
 void Thread::search() {
 
+  // The helper threads of a perft run count the root moves left
+  if (Limits.perft)
+  {
+      perft_root_moves(rootPos, Limits.perft);
+      return;
+  }
+
   // To allow access to (ss-7) up to (ss+2), the stack must be oversized.
   // The former is needed to allow update_continuation_histories(ss-1, ...),
   // which accesses its argument at ss-6, also near the root.
@@ -331,7 +481,7 @@ void Thread::search() {
   Depth adjustedDepth, pvDepth, lastBestMoveDepth = 0;
   Move lastBestMove = MOVE_NONE;
   Value bestValue, alpha, beta, delta, bestScore, previousScore;
-  bool reducedDepthSearch;
+  bool reducedDepthSearch, nullWindowLine;
   double timeReduction = 1, totBestMoveChanges = 0;
   int failedHighCnt;
   int iterRun = 0, iterIdx = 0;
@@ -412,6 +562,27 @@ void Thread::search() {
               alpha = std::max(previousScore - delta,-VALUE_INFINITE);
               beta  = std::min(previousScore + delta, VALUE_INFINITE);
 
+              // In MultiPV mode, center the window of the next lines on the score
+              // drift of the lines already resolved in this iteration, but not
+              // above the score of the line just before, as lines are searched
+              // in order of their previous score.
+              if (multiPV > 1 && pvIdx && pvIdx < multiPV)
+              {
+                  int drift = 0, cnt = 0;
+
+                  for (size_t i = 0; i < pvIdx; ++i)
+                      if (   abs(rootMoves[i].score) < VALUE_KNOWN_WIN
+                          && abs(rootMoves[i].previousScore) < VALUE_KNOWN_WIN)
+                          drift += rootMoves[i].score - rootMoves[i].previousScore, ++cnt;
+
+                  Value center = std::min(previousScore + (cnt ? drift / cnt : 0),
+                                          rootMoves[pvIdx - 1].score);
+
+                  delta = Value(21 + abs(center) / 256);
+                  alpha = std::max(center - delta,-VALUE_INFINITE);
+                  beta  = std::min(center + delta, VALUE_INFINITE);
+              }
+
               // Adjust contempt based on root move's previousScore (dynamic contempt)
               int dct = ct + (102 - ct / 2) * previousScore / (abs(previousScore) + 157);
 
@@ -443,6 +614,20 @@ void Thread::search() {
           adjustedDepth = pvDepth;
           reducedDepthSearch = false;
 
+          // In MultiPV mode the lines after the first multiPV ones only need
+          // to know whether they beat the k-th best score, so search them
+          // first with a null window just below it.
+          nullWindowLine =   multiPV > 1
+                          && pvIdx >= multiPV
+                          && rootDepth >= 4
+                          && !TB::RootInTB;
+
+          if (nullWindowLine)
+          {
+              beta = rootMoves[multiPV - 1].score;
+              alpha = beta - 1;
+          }
+
           // Start with a small aspiration window and, in the case of a fail
           // high/low, re-search with a bigger window until we don't fail
           // high/low anymore.
@@ -473,6 +658,19 @@ void Thread::search() {
               if (Threads.stop)
                   break;
 
+              // A trailing line failing low keeps its upper bound as score and
+              // is done, otherwise it enters the MultiPV set and is re-searched
+              // with a normal window to get an exact score.
+              if (nullWindowLine)
+              {
+                  if (bestValue <= alpha)
+                      break;
+
+                  nullWindowLine = false;
+                  beta = std::min(bestValue + delta, VALUE_INFINITE);
+                  continue;
+              }
+
               // When failing high/low give some update before a re-search
               // (without cluttering the UI).
               if (    mainThread
@@ -487,6 +685,8 @@ void Thread::search() {
               // re-search, otherwise exit the loop.
               if (bestValue <= alpha)
               {
+                  stats.count(ASPIRATION_FAIL_LOW);
+
                   beta = (alpha + beta) / 2;
                   alpha = std::max(bestValue - delta, -VALUE_INFINITE);
 
@@ -497,6 +697,8 @@ void Thread::search() {
               }
               else if (bestValue >= beta)
               {
+                  stats.count(ASPIRATION_FAIL_HIGH);
+
                   beta = std::min(bestValue + delta, VALUE_INFINITE);
 
                   if (!reducedDepthSearch)
@@ -619,11 +821,27 @@ void Thread::search() {
 
 namespace {
 
-  // search<>() is the main search function for both PV and non-PV nodes
+  // search<>() is the main search function for both PV and non-PV nodes. It
+  // calls search_node<>() and, in builds with the search log, records the node.
 
   template <NodeType NT>
   Value search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode) {
 
+    Value v = search_node<NT>(pos, ss, alpha, beta, depth, cutNode);
+
+    if (SearchLog::Enabled && depth > 0)
+        SearchLog::record(pos.key(), (ss-1)->currentMove, ss->ply, depth, alpha, beta, v,
+                            (NT == PV ? SearchLog::PV_NODE : 0)
+                          | (ss->excludedMove ? SearchLog::EXCLUDED : 0));
+    return v;
+  }
+
+
+  // search_node<>() searches a node of the main search
+
+  template <NodeType NT>
+  Value search_node(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode) {
+
     constexpr bool PvNode = NT == PV;
     const bool rootNode = PvNode && ss->ply == 0;
 
@@ -659,6 +877,8 @@ namespace {
     oldAlpha = alpha;
     ss->pv.clear(); // Refresh pv
 
+    thisThread->stats.node(ss->ply);
+
     if (PvNode)
         thisThread->selDepth = std::max(ss->ply, thisThread->selDepth);
 
@@ -736,6 +956,9 @@ namespace {
         tte = TT.probe(posKey, ttHit);
         ttValue = ttHit ? value_from_tt(tte->value(), ss->ply) : VALUE_NONE;
         ttMove  = ttHit ? tte->move() : MOVE_NONE;
+
+        thisThread->stats.count(TT_PROBE);
+        thisThread->stats.count(TT_HIT, ttHit);
     }
 
     ttPv = PvNode || (ttHit && tte->is_pv());
@@ -845,7 +1068,7 @@ namespace {
         // Never assume anything about values stored in TT
         ss->staticEval = eval = tte->eval();
         if (eval == VALUE_NONE)
-            ss->staticEval = eval = evaluate(pos);
+            ss->staticEval = eval = cached_evaluate(pos);
 
         // Can ttValue be used as a better position evaluation?
         if (    ttValue != VALUE_NONE
@@ -858,7 +1081,7 @@ namespace {
         {
             int bonus = -(ss-1)->statScore / 512;
 
-            ss->staticEval = eval = evaluate(pos) + bonus;
+            ss->staticEval = eval = cached_evaluate(pos) + bonus;
         }
         else
             ss->staticEval = eval = -(ss-1)->staticEval + 2 * VALUE_TEMPO;
@@ -921,6 +1144,8 @@ namespace {
 
         pos.undo_null_move();
 
+        thisThread->stats.count(NULL_TRY);
+
         if (nullValue >= beta)
         {
             // Do not return unproven mate scores
@@ -928,13 +1153,19 @@ namespace {
                 nullValue = beta;
 
             if (abs(beta) < VALUE_KNOWN_WIN && depth < 11)
+            {
+                thisThread->stats.count(NULL_CUT);
                 return nullValue;
+            }
 
             // Do verification search at high depths with R=3
             Value v = search<NonPV>(pos, ss, beta-1, beta, depth-3, false);
 
             if (v >= beta)
+            {
+                thisThread->stats.count(NULL_CUT);
                 return nullValue;
+            }
         }
     }
 
@@ -953,7 +1184,7 @@ namespace {
 
         while ((move = mp.next_move()) != MOVE_NONE && probCutCount < 2 + 2 * cutNode) // try at most 4 moves
         {
-            if (move == excludedMove || !pos.legal(move))
+            if (move == excludedMove)
                 continue;
 
             assert(pos.capture_or_promotion(move));
@@ -976,8 +1207,13 @@ namespace {
 
             pos.undo_move(move);
 
+            thisThread->stats.count(PROBCUT_TRY);
+
             if (value >= raisedBeta)
+            {
+                thisThread->stats.count(PROBCUT_CUT);
                 return value;
+            }
         }
     }
 
@@ -1016,7 +1252,7 @@ moves_loop: // When in check, search starts from here
     // Mark this node as being searched
     ThreadHolding th(thisThread, posKey, ss->ply);
 
-    // Step 12. Loop through all pseudo-legal moves until no moves remain
+    // Step 12. Loop through all legal moves until no moves remain
     // or a beta cutoff occurs.
     while ((move = mp.next_move(moveCountPruning)) != MOVE_NONE)
     {
@@ -1026,10 +1262,9 @@ moves_loop: // When in check, search starts from here
           continue;
 
       // At root obey the "searchmoves" option and skip moves not listed in Root
-      // Move List. As a consequence any illegal move is also skipped. In MultiPV
-      // mode we not only skip PV moves which have already been searched and those
-      // of lower "TB rank" if we are in a TB root position, but also those moves
-      // which will later be searched as PV moves anyways.
+      // Move List. In MultiPV mode we not only skip PV moves which have already
+      // been searched and those of lower "TB rank" if we are in a TB root position,
+      // but also those moves which will later be searched as PV moves anyways.
       if (rootNode)
       {
           if (!std::count(thisThread->rootMoves.begin() + thisThread->pvIdx,
@@ -1113,8 +1348,7 @@ moves_loop: // When in check, search starts from here
        /* &&  ttValue != VALUE_NONE Already implicit in the next condition */
           &&  abs(ttValue) < VALUE_KNOWN_WIN
           && (tte->bound() & BOUND_LOWER)
-          &&  tte->depth() >= depth - 3
-          &&  pos.legal(move))
+          &&  tte->depth() >= depth - 3)
       {
           Value singularBeta = ttValue - (((ttPv && !PvNode) + 4) * depth) / 2;
           Depth singularDepth = (depth - 1 + 3 * (ttPv && !PvNode)) / 2;
@@ -1123,10 +1357,13 @@ moves_loop: // When in check, search starts from here
           value = search<NonPV>(pos, ss, singularBeta-1, singularBeta, singularDepth, cutNode);
           ss->excludedMove = MOVE_NONE;
 
+          thisThread->stats.count(SINGULAR_TRY);
+
           if (value < singularBeta)
           {
               extension = 1;
               singularLMR = true;
+              thisThread->stats.count(SINGULAR_EXT);
           }
 
           // Multi-cut pruning
@@ -1135,7 +1372,10 @@ moves_loop: // When in check, search starts from here
           // that multiple moves fail high, and we can prune the whole subtree by returning
           // a soft bound.
           else if (singularBeta >= beta)
+          {
+              thisThread->stats.count(MULTI_CUT);
               return singularBeta;
+          }
       }
 
       // Check extension (~2 Elo)
@@ -1162,21 +1402,15 @@ moves_loop: // When in check, search starts from here
       newDepth += extension;
 
       // Speculative prefetch as early as possible
-      prefetch(TT.first_entry(pos.key_after(move)));
-
-      // Check for legality just before making the move
-      if (!rootNode && !pos.legal(move))
-      {
-          ss->moveCount = --moveCount;
-          continue;
-      }
+      Key newKey = pos.key_after(move);
+      prefetch(TT.first_entry(newKey));
 
       // Update the current move (this must be done after singular extension search)
       ss->currentMove = move;
       ss->continuationHistory = &thisThread->continuationHistory[inCheck][captureOrPromotion][movedPiece][to_sq(move)];
 
       // Step 15. Make the move
-      pos.do_move(move, st, givesCheck);
+      pos.do_move(move, st, givesCheck, newKey);
 
       // Step 16. Reduced depth search (LMR). If the move fails high it will be
       // re-searched at full depth.
@@ -1259,6 +1493,9 @@ moves_loop: // When in check, search starts from here
 
           doFullDepthSearch = value > alpha && d != newDepth;
           didLMR = true;
+
+          thisThread->stats.count(LMR_TRY);
+          thisThread->stats.count(LMR_RESEARCH, doFullDepthSearch);
       }
       else
       {
@@ -1287,7 +1524,10 @@ moves_loop: // When in check, search starts from here
       // high (in the latter case search only if value < beta), otherwise let the
       // parent node fail low with value <= alpha and try another move.
       if (PvNode && (moveCount == 1 || (value > alpha && (rootNode || value < beta))))
+      {
+          thisThread->stats.count(PV_RESEARCH, moveCount > 1);
           value = -search<PV>(pos, ss+1, -beta, -alpha, newDepth, false);
+      }
 
       // Step 18. Undo move
       pos.undo_move(move);
@@ -1356,6 +1596,7 @@ moves_loop: // When in check, search starts from here
               {
                   assert(value >= beta); // Fail high
                   ss->statScore = 0;
+                  thisThread->stats.cutoff(moveCount);
                   break;
               }
           }
@@ -1430,9 +1671,24 @@ moves_loop: // When in check, search starts from here
 
   // qsearch() is the quiescence search function, which is called by the main search
   // function with zero depth, or recursively with further decreasing depth per call.
+  // As search<>(), it wraps qsearch_node<>() to record the node in the search log.
   template <NodeType NT>
   Value qsearch(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth) {
 
+    Value v = qsearch_node<NT>(pos, ss, alpha, beta, depth);
+
+    if (SearchLog::Enabled)
+        SearchLog::record(pos.key(), (ss-1)->currentMove, ss->ply, depth, alpha, beta, v,
+                          SearchLog::QSEARCH | (NT == PV ? SearchLog::PV_NODE : 0));
+    return v;
+  }
+
+
+  // qsearch_node<>() searches a node of the quiescence search
+
+  template <NodeType NT>
+  Value qsearch_node(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth) {
+
     constexpr bool PvNode = NT == PV;
 
     assert(alpha >= -VALUE_INFINITE && alpha < beta && beta <= VALUE_INFINITE);
@@ -1456,6 +1712,8 @@ moves_loop: // When in check, search starts from here
     oldAlpha = alpha; // To flag BOUND_EXACT when eval above alpha
     ss->pv.clear();
 
+    thisThread->stats.qnode(ss->ply);
+
     if (PvNode)
         thisThread->selDepth = std::max(ss->ply, thisThread->selDepth);
 
@@ -1487,6 +1745,9 @@ moves_loop: // When in check, search starts from here
     ttMove = ttHit ? tte->move() : MOVE_NONE;
     pvHit = ttHit && tte->is_pv();
 
+    thisThread->stats.count(TT_PROBE);
+    thisThread->stats.count(TT_HIT, ttHit);
+
     if (  !PvNode
         && ttHit
         && tte->depth() >= ttDepth
@@ -1507,7 +1768,7 @@ moves_loop: // When in check, search starts from here
         {
             // Never assume anything about values stored in TT
             if ((ss->staticEval = bestValue = tte->eval()) == VALUE_NONE)
-                ss->staticEval = bestValue = evaluate(pos);
+                ss->staticEval = bestValue = cached_evaluate(pos);
 
             // Can ttValue be used as a better position evaluation?
             if (   !PvNode
@@ -1517,7 +1778,7 @@ moves_loop: // When in check, search starts from here
         }
         else
             ss->staticEval = bestValue =
-            (ss-1)->currentMove != MOVE_NULL ? evaluate(pos)
+            (ss-1)->currentMove != MOVE_NULL ? cached_evaluate(pos)
                                              : -(ss-1)->staticEval + 2 * VALUE_TEMPO;
 
         // Stand pat. Return immediately if static value is at least beta
@@ -1595,20 +1856,14 @@ moves_loop: // When in check, search starts from here
           continue;
 
       // Speculative prefetch as early as possible
-      prefetch(TT.first_entry(pos.key_after(move)));
-
-      // Check for legality just before making the move
-      if (!pos.legal(move))
-      {
-          moveCount--;
-          continue;
-      }
+      Key newKey = pos.key_after(move);
+      prefetch(TT.first_entry(newKey));
 
       ss->currentMove = move;
       ss->continuationHistory = &thisThread->continuationHistory[inCheck][captureOrPromotion][pos.moved_piece(move)][to_sq(move)];
 
       // Make and search the move
-      pos.do_move(move, st, givesCheck);
+      pos.do_move(move, st, givesCheck, newKey);
       value = -qsearch<NT>(pos, ss+1, -beta, -alpha, depth - 1);
       pos.undo_move(move);
 
@@ -1688,6 +1943,31 @@ moves_loop: // When in check, search starts from here
   }
 
 
+  // cached_evaluate() returns the static eval of the position, looking it up in
+  // the eval hash first when the table is enabled.
+
+  Value cached_evaluate(const Position& pos) {
+
+    if (!EvalHash.enabled())
+        return evaluate(pos);
+
+    StatsCollector& stats = pos.this_thread()->stats;
+    Value v;
+
+    stats.count(EVAL_HASH_PROBE);
+
+    if (EvalHash.probe(pos.key(), v))
+    {
+        stats.count(EVAL_HASH_HIT);
+        return v;
+    }
+
+    v = evaluate(pos);
+    EvalHash.save(pos.key(), v);
+    return v;
+  }
+
+
   // update_continuation_histories() updates histories of the move pairs formed
   // by moves at ply -1, -2, -4 and -6 with current move.
 
@@ -1789,6 +2069,92 @@ void MainThread::check_time() {
 }
 
 
+/// TreeStats<true>::operator+=() adds the counters of another thread, used to
+/// sum up the statistics of the whole thread pool.
+
+void Search::TreeStats<true>::operator+=(const TreeStats& s) {
+
+  for (int i = 0; i < MAX_PLY; ++i)
+      nodes[i] += s.nodes[i], qnodes[i] += s.qnodes[i];
+
+  for (int i = 0; i < CutoffIndexNb; ++i)
+      cutoffs[i] += s.cutoffs[i];
+
+  for (int i = 0; i < STATS_COUNTER_NB; ++i)
+      counters[i] += s.counters[i];
+}
+
+
+/// TreeStats<true>::to_json() formats the counters as a JSON object. Per-ply
+/// arrays are cut after the last non-zero entry, while the last slot of the
+/// cutoff array collects all the cutoffs at move number CutoffIndexNb or later.
+
+string Search::TreeStats<true>::to_json(size_t threads) const {
+
+  std::stringstream ss;
+
+  auto array = [&](const uint64_t* a, int n) {
+      while (n > 0 && !a[n - 1])
+          --n;
+
+      ss << "[";
+      for (int i = 0; i < n; ++i)
+          ss << (i ? ", " : "") << a[i];
+      ss << "]";
+  };
+
+  auto rate = [&](StatsCounter num, StatsCounter den) {
+      ss << std::fixed << std::setprecision(4)
+         << (counters[den] ? double(counters[num]) / counters[den] : 0.0);
+  };
+
+  ss << "{\n  \"threads\": " << threads
+     << ",\n  \"nodes\": ";                   array(nodes, MAX_PLY);
+  ss << ",\n  \"qnodes\": ";                  array(qnodes, MAX_PLY);
+  ss << ",\n  \"cutoffs\": ";                 array(cutoffs, CutoffIndexNb);
+  ss << ",\n  \"tt\": { \"probes\": "          << counters[TT_PROBE]
+     << ", \"hits\": "                          << counters[TT_HIT]
+     << ", \"rate\": ";                         rate(TT_HIT, TT_PROBE);
+  ss << " },\n  \"nullMove\": { \"tries\": "   << counters[NULL_TRY]
+     << ", \"cutoffs\": "                       << counters[NULL_CUT]
+     << ", \"rate\": ";                         rate(NULL_CUT, NULL_TRY);
+  ss << " },\n  \"probCut\": { \"tries\": "    << counters[PROBCUT_TRY]
+     << ", \"cutoffs\": "                       << counters[PROBCUT_CUT]
+     << ", \"rate\": ";                         rate(PROBCUT_CUT, PROBCUT_TRY);
+  ss << " },\n  \"singular\": { \"tries\": "   << counters[SINGULAR_TRY]
+     << ", \"extensions\": "                    << counters[SINGULAR_EXT]
+     << ", \"multiCuts\": "                     << counters[MULTI_CUT]
+     << ", \"rate\": ";                         rate(SINGULAR_EXT, SINGULAR_TRY);
+  ss << " },\n  \"lmr\": { \"tries\": "        << counters[LMR_TRY]
+     << ", \"researches\": "                    << counters[LMR_RESEARCH]
+     << ", \"researchRate\": ";                 rate(LMR_RESEARCH, LMR_TRY);
+  ss << " },\n  \"researches\": { \"pv\": "    << counters[PV_RESEARCH]
+     << ", \"aspirationLow\": "                 << counters[ASPIRATION_FAIL_LOW]
+     << ", \"aspirationHigh\": "                << counters[ASPIRATION_FAIL_HIGH]
+     << " },\n  \"quietChecks\": { \"probes\": " << counters[QCHECK_PROBE]
+     << ", \"hits\": "                          << counters[QCHECK_HIT]
+     << ", \"rate\": ";                         rate(QCHECK_HIT, QCHECK_PROBE);
+  ss << " },\n  \"lazyEval\": { \"evals\": "   << counters[EVAL_CALL]
+     << ", \"skipsAfterPawns\": "               << counters[LAZY_SKIP_PAWNS]
+     << ", \"skipsAfterPieces\": "              << counters[LAZY_SKIP_PIECES]
+     << ", \"pawnsRate\": ";                    rate(LAZY_SKIP_PAWNS, EVAL_CALL);
+  ss << ", \"piecesRate\": ";                   rate(LAZY_SKIP_PIECES, EVAL_CALL);
+  ss << " },\n  \"evalHash\": { \"probes\": "  << counters[EVAL_HASH_PROBE]
+     << ", \"hits\": "                          << counters[EVAL_HASH_HIT]
+     << ", \"rate\": ";                         rate(EVAL_HASH_HIT, EVAL_HASH_PROBE);
+  ss << " },\n  \"kingSafety\": { \"probes\": " << counters[KING_SAFETY_PROBE]
+     << ", \"shelterComputes\": "               << counters[KING_SAFETY_MISS]
+     << ", \"computeRate\": ";                  rate(KING_SAFETY_MISS, KING_SAFETY_PROBE);
+  ss << " },\n  \"quiets\": { \"generations\": " << counters[QUIET_GEN]
+     << ", \"generated\": "                     << counters[QUIET_MOVES]
+     << ", \"tried\": "                         << counters[QUIET_TRIED]
+     << ", \"triedRate\": ";                    rate(QUIET_TRIED, QUIET_MOVES);
+  ss << " }\n}";
+
+  return ss.str();
+}
+
+
 /// UCI::pv() formats PV information according to the UCI protocol. UCI requires
 /// that all (if any) unsearched PV lines are sent using a previous search score.
 
@@ -21,6 +21,8 @@
 #ifndef SEARCH_H_INCLUDED
 #define SEARCH_H_INCLUDED
 
+#include <cstring>   // For std::memset
+#include <string>
 #include <vector>
 
 #include "misc.h"
@@ -88,6 +90,72 @@ struct RootMove {
 typedef std::vector<RootMove> RootMoves;
 
 
+/// TreeStats collects per-thread counters about the shape of the search tree:
+/// nodes per ply, the move number of beta cutoffs, the TT hit rate and how
+/// often the selective search techniques succeed or cause a re-search. The
+/// counters are only collected in builds done with 'make stats=yes', in the
+/// default build the empty specialization is used and all the calls in the
+/// search compile to nothing.
+
+#ifdef USE_STATS
+constexpr bool CollectStats = true;
+#else
+constexpr bool CollectStats = false;
+#endif
+
+enum StatsCounter {
+  TT_PROBE, TT_HIT,
+  NULL_TRY, NULL_CUT,
+  PROBCUT_TRY, PROBCUT_CUT,
+  SINGULAR_TRY, SINGULAR_EXT, MULTI_CUT,
+  LMR_TRY, LMR_RESEARCH,
+  PV_RESEARCH, ASPIRATION_FAIL_LOW, ASPIRATION_FAIL_HIGH,
+  QCHECK_PROBE, QCHECK_HIT,
+  EVAL_CALL, LAZY_SKIP_PAWNS, LAZY_SKIP_PIECES,
+  EVAL_HASH_PROBE, EVAL_HASH_HIT,
+  KING_SAFETY_PROBE, KING_SAFETY_MISS,
+  QUIET_GEN, QUIET_MOVES, QUIET_TRIED,
+  STATS_COUNTER_NB
+};
+
+constexpr int CutoffIndexNb = 32;
+
+template<bool Collect> struct TreeStats;
+
+template<>
+struct TreeStats<true> {
+
+  void clear() { std::memset(this, 0, sizeof(TreeStats)); }
+  void node(int ply) { ++nodes[std::min(ply, MAX_PLY - 1)]; }
+  void qnode(int ply) { ++qnodes[std::min(ply, MAX_PLY - 1)]; }
+  void cutoff(int moveCount) { ++cutoffs[std::min(moveCount, CutoffIndexNb) - 1]; }
+  void count(StatsCounter c, bool b = true) { counters[c] += b; }
+  void add(StatsCounter c, uint64_t n) { counters[c] += n; }
+  void operator+=(const TreeStats& s);
+  std::string to_json(size_t threads) const;
+
+  uint64_t nodes[MAX_PLY];
+  uint64_t qnodes[MAX_PLY];
+  uint64_t cutoffs[CutoffIndexNb];
+  uint64_t counters[STATS_COUNTER_NB];
+};
+
+template<>
+struct TreeStats<false> {
+
+  void clear() {}
+  void node(int) {}
+  void qnode(int) {}
+  void cutoff(int) {}
+  void count(StatsCounter, bool = true) {}
+  void add(StatsCounter, uint64_t) {}
+  void operator+=(const TreeStats&) {}
+  std::string to_json(size_t) const { return std::string(); }
+};
+
+typedef TreeStats<CollectStats> StatsCollector;
+
+
 /// LimitsType struct stores information sent by GUI about available time to
 /// search the current move, maximum depth/time, or if we are in analysis mode.
 
@@ -97,6 +165,7 @@ struct LimitsType {
     time[WHITE] = time[BLACK] = inc[WHITE] = inc[BLACK] = npmsec = movetime = TimePoint(0);
     movestogo = depth = mate = perft = infinite = 0;
     nodes = 0;
+    deterministic = divide = false;
   }
 
   bool use_time_management() const {
@@ -107,12 +176,14 @@ struct LimitsType {
   TimePoint time[COLOR_NB], inc[COLOR_NB], npmsec, movetime, startTime;
   int movestogo, depth, mate, perft, infinite;
   int64_t nodes;
+  bool deterministic, divide;
 };
 
 extern LimitsType Limits;
 
 void init();
 void clear();
+void print_stats();
 
 } // namespace Search
 
@@ -0,0 +1,215 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "misc.h"
+#include "searchlog.h"
+
+namespace {
+
+  using namespace SearchLog;
+
+  // Ring is a single producer, single consumer queue of records. The search
+  // thread owning the ring advances 'head', the writer thread advances 'tail'.
+  struct Ring {
+
+    static constexpr size_t Size = 1 << 16; // Must be a power of 2
+
+    Record records[Size];
+    std::atomic<size_t> head, tail;
+    std::atomic<bool> owned;
+    uint32_t stream;
+  };
+
+  std::mutex mutex; // Protects 'rings' and 'file'
+  std::vector<std::unique_ptr<Ring>> rings;
+  std::atomic<bool> active(false), quit(false);
+  std::thread writer;
+  FILE* file = nullptr;
+
+  // RingHandle binds a ring to the thread that fills it. Rings are never freed,
+  // when a thread exits its ring is released and reused by the next new thread.
+  struct RingHandle {
+
+    ~RingHandle() { if (ring) ring->owned = false; }
+
+    Ring* get() {
+
+      if (ring)
+          return ring;
+
+      std::lock_guard<std::mutex> lk(mutex);
+
+      for (auto& r : rings)
+          if (!r->owned)
+          {
+              r->owned = true;
+              return ring = r.get();
+          }
+
+      rings.emplace_back(new Ring());
+      ring = rings.back().get();
+      ring->head = ring->tail = 0;
+      ring->owned = true;
+      ring->stream = uint32_t(rings.size() - 1);
+      return ring;
+    }
+
+    Ring* ring = nullptr;
+  };
+
+  thread_local RingHandle handle;
+
+  // drain() writes the pending records of a ring to the file as one or two
+  // chunks (when wrapping around the end of the buffer). Returns the number
+  // of records written. Called with the mutex held.
+  size_t drain(Ring& r) {
+
+    size_t head = r.head.load(std::memory_order_acquire);
+    size_t tail = r.tail.load(std::memory_order_relaxed);
+    size_t written = head - tail;
+
+    while (tail != head)
+    {
+        size_t start = tail & (Ring::Size - 1);
+        size_t n = std::min(head - tail, Ring::Size - start);
+        ChunkHeader ch = { r.stream, uint32_t(n) };
+
+        fwrite(&ch, sizeof(ch), 1, file);
+        fwrite(&r.records[start], sizeof(Record), n, file);
+        tail += n;
+    }
+
+    r.tail.store(tail, std::memory_order_release);
+    return written;
+  }
+
+  // writer_loop() is run by the background writer thread until the log is
+  // closed, then it drains the rings a last time.
+  void writer_loop() {
+
+    while (!quit)
+    {
+        size_t written = 0;
+
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+
+            for (auto& r : rings)
+                written += drain(*r);
+        }
+
+        if (!written)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    for (auto& r : rings)
+        drain(*r);
+  }
+
+} // namespace
+
+
+/// SearchLog::open() starts logging to the given file, closing the previous
+/// log if any. An empty name or "<empty>" just stops logging. Must not be
+/// called while searching.
+
+void SearchLog::open(const std::string& fname) {
+
+  close();
+
+  if (fname.empty() || fname == "<empty>")
+      return;
+
+  file = fopen(fname.c_str(), "wb");
+
+  if (!file)
+  {
+      sync_cout << "info string Unable to open search log " << fname << sync_endl;
+      return;
+  }
+
+  FileHeader fh = { Magic, Version };
+  fwrite(&fh, sizeof(fh), 1, file);
+
+  for (auto& r : rings)
+      r->head = r->tail = 0;
+
+  quit = false;
+  active = true;
+  writer = std::thread(writer_loop);
+}
+
+
+/// SearchLog::close() flushes the pending records and closes the log file
+
+void SearchLog::close() {
+
+  if (!file)
+      return;
+
+  active = false;
+  quit = true;
+  writer.join();
+  fclose(file);
+  file = nullptr;
+}
+
+
+/// SearchLog::record() appends a node to the ring of the calling thread. If
+/// the ring is full we wait for the writer instead of dropping records.
+
+void SearchLog::record(Key key, Move move, int ply, Depth depth,
+                       Value alpha, Value beta, Value v, int flags) {
+
+  if (!active.load(std::memory_order_relaxed))
+      return;
+
+  Ring* r = handle.get();
+  size_t head = r->head.load(std::memory_order_relaxed);
+
+  while (head - r->tail.load(std::memory_order_acquire) >= Ring::Size)
+      if (active.load(std::memory_order_relaxed))
+          std::this_thread::yield();
+      else
+          return;
+
+  Record& rec = r->records[head & (Ring::Size - 1)];
+  rec.key   = key;
+  rec.alpha = int16_t(alpha);
+  rec.beta  = int16_t(beta);
+  rec.value = int16_t(v);
+  rec.move  = uint16_t(move);
+  rec.depth = int16_t(depth);
+  rec.ply   = uint8_t(ply);
+  rec.flags = uint8_t(flags);
+
+  r->head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,83 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEARCHLOG_H_INCLUDED
+#define SEARCHLOG_H_INCLUDED
+
+#include <string>
+
+#include "types.h"
+
+/// The search log records every node visited by the search into a binary file
+/// for offline replay. Each search thread appends fixed size records to its own
+/// ring buffer, that a background thread drains to disk, so that logging a huge
+/// tree does not slow down the search by orders of magnitude. Logging is only
+/// compiled in with 'make searchlog=yes' and is active while the 'Search Log
+/// File' UCI option names a file. The 'treedump' Makefile target builds a tool
+/// that reconstructs the trees from such a file.
+///
+/// File layout: a FileHeader followed by chunks, each one a ChunkHeader and
+/// 'count' Records of thread 'stream'. The records of a thread are written in
+/// post-order (a node is recorded when the search returns from it), so the
+/// children of a node at ply p are the records at ply p+1 preceding it.
+
+namespace SearchLog {
+
+#ifdef USE_SEARCHLOG
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+
+constexpr uint32_t Magic   = 0x474C534D; // "MSLG"
+constexpr uint32_t Version = 2;
+
+enum RecordFlags : uint8_t {
+  PV_NODE = 1, QSEARCH = 2, EXCLUDED = 4
+};
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct ChunkHeader {
+  uint32_t stream;
+  uint32_t count;
+};
+
+struct Record {
+  uint64_t key;
+  int16_t alpha, beta, value;
+  uint16_t move;  // Move leading to this node, MOVE_NONE at root
+  int16_t depth;  // Remaining depth, zero or negative in qsearch
+  uint8_t ply;
+  uint8_t flags;
+};
+
+static_assert(sizeof(Record) == 24, "Record size incorrect");
+
+void open(const std::string& fname);
+void close();
+void record(Key key, Move move, int ply, Depth depth, Value alpha, Value beta, Value v, int flags);
+
+} // namespace SearchLog
+
+#endif // #ifndef SEARCHLOG_H_INCLUDED
@@ -79,6 +79,9 @@ void Thread::clear() {
   for (bool inCheck : { false, true })
       for (StatsType c : { NoCaptures, Captures })
           continuationHistory[inCheck][c][NO_PIECE][0]->fill(Search::CounterMovePruneThreshold - 1);
+
+  pawnsEntry = Pawns::Entry(); // Zero key, a miss on the first probe of the shared table
+  stats.clear();
 }
 
 /// Thread::start_searching() wakes up the thread that will start the search
@@ -153,12 +156,29 @@ void ThreadPool::set(size_t requested) {
 
       // Reallocate the hash with the new threadpool size
       TT.resize(Options["Hash"]);
+      set_pawn_hash();
 
       // Init thread number dependent search params
       Search::init();
   }
 }
 
+/// ThreadPool::set_pawn_hash() allocates the pawn hash tables according to the
+/// UCI options: a table per thread or, if shared, a single one for all threads.
+
+void ThreadPool::set_pawn_hash() {
+
+  main()->wait_for_search_finished();
+
+  size_t mbSize = Options["Pawn Hash"];
+  bool shared = Options["Shared Pawn Hash"];
+
+  Pawns::Shared.resize(shared ? mbSize : 0);
+
+  for (Thread* th : *this)
+      th->pawnsTable.resize(shared ? 0 : mbSize);
+}
+
 /// ThreadPool::clear() sets threadPool data to initial values
 
 void ThreadPool::clear() {
@@ -204,20 +224,18 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
 
   // We use Position::set() to set root position across threads. But there are
   // some StateInfo fields (previous, pliesFromNull, capturedPiece) that cannot
-  // be deduced from a fen string, so set() clears them and to not lose the info
-  // we need to backup and later restore setupStates->back(). Note that setupStates
-  // is shared by threads but is accessed in read-only mode.
-  StateInfo tmp = setupStates->back();
-
+  // be deduced from a fen string, so set() clears them and we copy the last
+  // setup state over the root state of each thread afterwards. Each thread has
+  // its own root state because the search writes to it (NNUE accumulator), the
+  // earlier setupStates are shared by threads but accessed in read-only mode.
   for (Thread* th : *this)
   {
       th->nodes = th->tbHits = th->bestMoveChanges = 0;
       th->rootDepth = 1, th->completedDepth = 0;
       th->rootMoves = rootMoves;
-      th->rootPos.set(pos.fen(), pos.is_chess960(), &setupStates->back(), th);
+      th->rootPos.set(pos.fen(), pos.is_chess960(), &th->rootState, th);
+      th->rootState = setupStates->back();
   }
 
-  setupStates->back() = tmp;
-
   main()->start_searching();
 }
@@ -38,7 +38,8 @@
 /// Thread class keeps together all the thread-related stuff. We use
 /// per-thread pawn and material hash tables so that once we get a
 /// pointer to an entry its life time is unlimited and we don't have
-/// to care about someone changing the entry under our feet.
+/// to care about someone changing the entry under our feet. With the
+/// shared pawn hash table the thread uses its own copy of the entry.
 
 class Thread {
 
@@ -59,7 +60,9 @@ public:
   int best_move_count(Move move);
 
   Pawns::Table pawnsTable;
+  Pawns::Entry pawnsEntry;
   Material::Table materialTable;
+  QuietChecksTable quietChecksTable;
   size_t pvIdx, pvLast, pvLines;
   uint64_t ttHitAverage;
   bool shortPv;
@@ -67,12 +70,14 @@ public:
   std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
 
   Position rootPos;
+  StateInfo rootState;
   Search::RootMoves rootMoves;
   Depth rootDepth, completedDepth;
   CounterMoveHistory counterMoves;
   ButterflyHistory mainHistory;
   CapturePieceToHistory captureHistory;
   ContinuationHistory continuationHistory[2][2];
+  Search::StatsCollector stats;
   Score contempt;
 };
 
@@ -104,6 +109,7 @@ struct ThreadPool : public std::vector<Thread*> {
   void start_thinking(Position&, StateListPtr&, const Search::LimitsType&, bool = false);
   void clear();
   void set(size_t);
+  void set_pawn_hash();
 
   MainThread* main()        const { return static_cast<MainThread*>(front()); }
   uint64_t nodes_searched() const { return accumulate(&Thread::nodes); }
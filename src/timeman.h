@@ -27,6 +27,11 @@
 
 /// The TimeManagement class computes the optimal time to think depending on
 /// the maximum available time, the game move number and other parameters.
+/// In deterministic mode the elapsed time is not read from the clock but
+/// derived from the searched nodes, at DeterministicNpms nodes per millisecond,
+/// so that all the decisions based on time depend only on node counts.
+
+constexpr int DeterministicNpms = 1000;
 
 class TimeManagement {
 public:
@@ -34,7 +39,10 @@ public:
   TimePoint optimum() const { return optimumTime; }
   TimePoint maximum() const { return maximumTime; }
   TimePoint elapsed() const { return Search::Limits.npmsec ?
-                                     TimePoint(Threads.nodes_searched()) : now() - startTime; }
+                                     TimePoint(Threads.nodes_searched())
+                                   : Search::Limits.deterministic ?
+                                     TimePoint(Threads.nodes_searched() / DeterministicNpms)
+                                   : now() - startTime; }
 
   int64_t availableNodes; // When in 'nodes as time' mode
 
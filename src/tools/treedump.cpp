@@ -0,0 +1,171 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// treedump reads a search log written by an engine built with 'make
+/// searchlog=yes' and prints the search trees it contains, one for each root
+/// search, followed by the number of nodes per ply. Usage:
+///
+/// treedump <file> [max ply] [stream]
+///
+/// Nodes deeper than 'max ply' (default 3) are not printed but still counted
+/// in the subtree sizes. If 'stream' is given only the trees searched by that
+/// thread are printed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../searchlog.h"
+
+using namespace SearchLog;
+
+namespace {
+
+  struct Node {
+    Record r;
+    uint64_t subtree;
+    std::vector<Node> children;
+  };
+
+  // Per thread state: nodes waiting for their parent, indexed by ply
+  struct Stream {
+    std::vector<std::vector<Node>> pending = std::vector<std::vector<Node>>(257);
+    uint64_t roots = 0;
+  };
+
+  std::string move_to_string(uint16_t m) {
+
+    if (m == MOVE_NONE)
+        return "root";
+
+    if (m == MOVE_NULL)
+        return "null";
+
+    std::string s;
+    s += char('a' + ((m >> 6) & 7));
+    s += char('1' + ((m >> 9) & 7));
+    s += char('a' + (m & 7));
+    s += char('1' + ((m >> 3) & 7));
+
+    if ((m & (3 << 14)) == PROMOTION)
+        s += " nbrq"[((m >> 12) & 3) + 1];
+
+    return s;
+  }
+
+  void print(const Node& n, int indent) {
+
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "%*s%-5s %016llx d %3d [%6d, %6d] -> %6d %s%s%s nodes %llu\n",
+                  indent * 2, "", move_to_string(n.r.move).c_str(),
+                  (unsigned long long)n.r.key, n.r.depth, n.r.alpha, n.r.beta, n.r.value,
+                  n.r.flags & PV_NODE  ? "pv " : "",
+                  n.r.flags & QSEARCH  ? "qs " : "",
+                  n.r.flags & EXCLUDED ? "ex " : "",
+                  (unsigned long long)n.subtree);
+    std::cout << buf;
+
+    for (const Node& c : n.children)
+        print(c, indent + 1);
+  }
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+
+  if (argc < 2)
+  {
+      std::cerr << "Usage: treedump <file> [max ply] [stream]" << std::endl;
+      return EXIT_FAILURE;
+  }
+
+  int maxPly = argc > 2 ? std::atoi(argv[2]) : 3;
+  long selected = argc > 3 ? std::atol(argv[3]) : -1;
+
+  FILE* f = std::fopen(argv[1], "rb");
+  FileHeader fh;
+
+  if (!f || std::fread(&fh, sizeof(fh), 1, f) != 1 || fh.magic != Magic || fh.version != Version)
+  {
+      std::cerr << "Not a search log: " << argv[1] << std::endl;
+      return EXIT_FAILURE;
+  }
+
+  std::map<uint32_t, Stream> streams;
+  std::vector<uint64_t> plyCount(256);
+  std::vector<Record> chunk;
+  ChunkHeader ch;
+
+  while (std::fread(&ch, sizeof(ch), 1, f) == 1)
+  {
+      chunk.resize(ch.count);
+
+      if (std::fread(chunk.data(), sizeof(Record), ch.count, f) != ch.count)
+      {
+          std::cerr << "Truncated chunk, stopping" << std::endl;
+          break;
+      }
+
+      Stream& st = streams[ch.stream];
+
+      // Records come in post-order: the children of a node at ply p are the
+      // nodes at ply p + 1 recorded since the previous node at ply p.
+      for (const Record& r : chunk)
+      {
+          Node n = { r, 1, {} };
+          std::vector<Node>& children = st.pending[r.ply + 1];
+
+          for (const Node& c : children)
+              n.subtree += c.subtree;
+
+          if (r.ply < maxPly)
+              n.children = std::move(children);
+
+          children.clear();
+          ++plyCount[r.ply];
+
+          if (r.ply == 0)
+          {
+              if (selected < 0 || selected == long(ch.stream))
+              {
+                  std::cout << "\nStream " << ch.stream << ", root search " << ++st.roots << "\n";
+                  print(n, 0);
+              }
+          }
+          else
+              st.pending[r.ply].push_back(std::move(n));
+      }
+  }
+
+  std::fclose(f);
+
+  std::cout << "\nNodes per ply:\n";
+
+  for (size_t ply = 0; ply < plyCount.size(); ++ply)
+      if (plyCount[ply])
+          std::cout << ply << ": " << plyCount[ply] << "\n";
+
+  return EXIT_SUCCESS;
+}
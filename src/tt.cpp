@@ -20,6 +20,7 @@
 
 #include <cstring>   // For std::memset
 #include <iostream>
+#include <new>       // For std::nothrow
 #include <thread>
 
 #include "bitboard.h"
@@ -29,6 +30,7 @@
 #include "uci.h"
 
 TranspositionTable TT; // Our global transposition table
+EvalHashTable EvalHash; // Our global eval hash
 
 /// TranspositionTable::resize() sets the size of the transposition table,
 /// measured in megabytes. Transposition table consists of a power of 2 number
@@ -161,3 +163,38 @@ int TranspositionTable::hashfull() const {
 
   return cnt * 1000 / (samples * ClusterSize);
 }
+
+
+/// EvalHashTable::resize() sets the size of the eval hash in megabytes, zero
+/// frees the table and disables it.
+
+void EvalHashTable::resize(size_t mbSize) {
+
+  Threads.main()->wait_for_search_finished();
+
+  entryCount = mbSize * 1024 * 1024 / sizeof(uint64_t);
+  table.reset();
+
+  if (!entryCount)
+      return;
+
+  table.reset(new (std::nothrow) std::atomic<uint64_t>[entryCount]);
+
+  if (!table)
+  {
+      std::cerr << "Failed to allocate " << mbSize
+                << "MB for eval hash." << std::endl;
+      exit(EXIT_FAILURE);
+  }
+
+  clear();
+}
+
+
+/// EvalHashTable::clear() empties the eval hash
+
+void EvalHashTable::clear() {
+
+  for (size_t i = 0; i < entryCount; ++i)
+      table[i].store(0, std::memory_order_relaxed);
+}
@@ -21,6 +21,9 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <atomic>
+#include <memory>
+
 #include "misc.h"
 #include "types.h"
 
@@ -102,4 +105,36 @@ private:
 
 extern TranspositionTable TT;
 
+
+/// EvalHashTable caches static evaluations independently of the transposition
+/// table, so that an eval is not lost when its TT entry is replaced. Each entry
+/// is a single 64 bit word, shared by all threads without locking, that packs
+/// the upper 48 bits of the position key with the 16 bit eval. A size of zero
+/// disables the table.
+
+class EvalHashTable {
+
+public:
+  bool probe(Key key, Value& v) const {
+    uint64_t data = table[index(key)].load(std::memory_order_relaxed);
+    return (data ^ key) >> 16 ? false : (v = Value(int16_t(data)), true);
+  }
+
+  void save(Key key, Value v) {
+    table[index(key)].store((key & ~uint64_t(0xFFFF)) | uint16_t(v), std::memory_order_relaxed);
+  }
+
+  bool enabled() const { return entryCount; }
+  void resize(size_t mbSize);
+  void clear();
+
+private:
+  size_t index(Key key) const { return (uint32_t(key) * uint64_t(entryCount)) >> 32; }
+
+  size_t entryCount = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> table;
+};
+
+extern EvalHashTable EvalHash;
+
 #endif // #ifndef TT_H_INCLUDED
@@ -0,0 +1,130 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "misc.h"
+#include "tune.h"
+
+namespace {
+
+  // The parameter table, filled during static initialization by the files
+  // declaring the parameters, hence a function local static.
+  std::vector<Tune::Param>& params() {
+    static std::vector<Tune::Param> table;
+    return table;
+  }
+
+  // values() returns the number of values a parameter takes in the file
+  size_t values(const Tune::Param& p) { return p.isScore ? 2 * p.count : p.count; }
+
+} // namespace
+
+
+/// Tune::add() appends parameters to the table. It returns a value so that it
+/// can initialize a dummy variable, to be called during static initialization.
+
+bool Tune::add(std::vector<Param> ps) {
+
+  params().insert(params().end(), ps.begin(), ps.end());
+  return true;
+}
+
+
+/// Tune::save() writes the current value of all the parameters to a file
+
+bool Tune::save(const std::string& fname) {
+
+  std::ofstream file(fname);
+
+  if (!file)
+      return false;
+
+  for (const Param& p : params())
+  {
+      file << p.name;
+
+      for (size_t i = 0; i < p.count; ++i)
+          if (p.isScore)
+              file << " " << mg_value(Score(p.values[i])) << " " << eg_value(Score(p.values[i]));
+          else
+              file << " " << p.values[i];
+
+      file << "\n";
+  }
+
+  return bool(file);
+}
+
+
+/// Tune::load() reads parameters from a file written by save(). Parameters
+/// missing from the file keep their value. The whole file is checked before
+/// any parameter is changed, so that an error leaves all of them untouched.
+
+bool Tune::load(const std::string& fname) {
+
+  std::ifstream file(fname);
+  std::string line, name;
+  std::vector<std::pair<Param*, std::vector<int>>> updates;
+
+  if (!file)
+  {
+      sync_cout << "info string Unable to open " << fname << sync_endl;
+      return false;
+  }
+
+  for (int lineNb = 1; std::getline(file, line); ++lineNb)
+  {
+      std::istringstream is(line);
+
+      if (!(is >> name) || name[0] == '#')
+          continue;
+
+      Param* param = nullptr;
+
+      for (Param& p : params())
+          if (p.name == name)
+              param = &p;
+
+      std::vector<int> v;
+      int x;
+
+      while (is >> x)
+          v.push_back(x);
+
+      if (!param || !is.eof() || v.size() != values(*param))
+      {
+          sync_cout << "info string " << fname << ":" << lineNb << ": invalid parameter "
+                    << name << sync_endl;
+          return false;
+      }
+
+      updates.emplace_back(param, v);
+  }
+
+  for (auto& u : updates)
+      for (size_t i = 0; i < u.first->count; ++i)
+          u.first->values[i] = u.first->isScore ? make_score(u.second[2 * i], u.second[2 * i + 1])
+                                                : u.second[i];
+
+  return true;
+}
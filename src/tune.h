@@ -0,0 +1,76 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TUNE_H_INCLUDED
+#define TUNE_H_INCLUDED
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+
+/// The evaluation weights are compile time constants, unless the engine is
+/// built with 'make tune=yes'. Then they are declared TUNABLE, that is as
+/// plain variables, and registered by name in a parameter table that the
+/// 'evalparams' command saves to and loads from a text file, one parameter
+/// per line: the name followed by its values, a score being written as its
+/// middlegame and endgame values. Lines starting with '#' are comments.
+
+#ifdef USE_TUNE
+#  define TUNABLE
+#else
+#  define TUNABLE constexpr
+#endif
+
+namespace Tune {
+
+#ifdef USE_TUNE
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+
+/// Param describes a scalar or an array of int, Value or Score
+struct Param {
+
+  template<typename T>
+  Param(const char* n, T& v) : name(n), values(reinterpret_cast<int*>(&v)),
+                               count(sizeof(T) / sizeof(int)),
+                               isScore(std::is_same<typename std::remove_all_extents<T>::type, Score>::value) {
+
+      static_assert(sizeof(typename std::remove_all_extents<T>::type) == sizeof(int), "Not a parameter type");
+  }
+
+  std::string name;
+  int* values;
+  size_t count;
+  bool isScore;
+};
+
+#define TUNE_PARAM(x) Tune::Param(#x, x)
+
+bool add(std::vector<Param> params);
+bool save(const std::string& fname);
+bool load(const std::string& fname);
+
+} // namespace Tune
+
+#endif // #ifndef TUNE_H_INCLUDED
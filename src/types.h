@@ -37,6 +37,12 @@
 ///
 /// -DUSE_PEXT    | Add runtime support for use of pext asm-instruction. Works
 ///               | only in 64-bit mode and requires hardware with pext support.
+///
+/// -DUSE_AVX2    | Add runtime support for use of AVX2 vector instructions. Works
+///               | only in 64-bit mode and requires hardware with AVX2 support.
+///
+/// -DUSE_DISPATCH | Detect pext and AVX2 at startup and select the code paths
+///                | using them at runtime. Needs gcc or clang on x86-64.
 
 #include <cassert>
 #include <cctype>
@@ -73,25 +79,56 @@
 #  include <xmmintrin.h> // Intel and Microsoft header for _mm_prefetch()
 #endif
 
+#if defined(USE_PEXT) || defined(USE_AVX2) || defined(USE_DISPATCH)
+#  include <immintrin.h> // Header for _pext_u64() and AVX2 intrinsics
+#endif
+
 #if defined(USE_PEXT)
-#  include <immintrin.h> // Header for _pext_u64() intrinsic
 #  define pext(b, m) _pext_u64(b, m)
+#elif defined(USE_DISPATCH) // Not compiled with -mbmi2, so no intrinsic
+inline uint64_t pext(uint64_t b, uint64_t m) {
+  uint64_t r;
+  __asm__("pextq %2, %1, %0" : "=r" (r) : "r" (b), "rm" (m));
+  return r;
+}
 #else
 #  define pext(b, m) 0
 #endif
 
+/// With runtime dispatch the functions using AVX2 intrinsics are compiled for
+/// AVX2 alone, and are called only after HasAvx2 has been checked.
+
+#if defined(USE_DISPATCH)
+#  define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define TARGET_AVX2
+#endif
+
 #ifdef USE_POPCNT
 constexpr bool HasPopCnt = true;
 #else
 constexpr bool HasPopCnt = false;
 #endif
 
+#ifdef USE_DISPATCH
+extern bool HasPext; // Set by CPU::init() at startup
+extern bool HasAvx2;
+#else
+
 #ifdef USE_PEXT
 constexpr bool HasPext = true;
 #else
 constexpr bool HasPext = false;
 #endif
 
+#ifdef USE_AVX2
+constexpr bool HasAvx2 = true;
+#else
+constexpr bool HasAvx2 = false;
+#endif
+
+#endif
+
 #ifdef IS_64BIT
 constexpr bool Is64Bit = true;
 #else
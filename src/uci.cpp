@@ -18,23 +18,36 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "evaluate.h"
+#include "material.h"
 #include "movegen.h"
+#include "pawns.h"
 #include "position.h"
 #include "search.h"
 #include "thread.h"
 #include "timeman.h"
 #include "tt.h"
+#include "tune.h"
 #include "uci.h"
 #include "syzygy/tbprobe.h"
 
 using namespace std;
 
+namespace PSQT {
+
+  void init();
+}
+
 extern vector<string> setup_bench(const Position&, istream&);
 
 namespace {
@@ -120,6 +133,7 @@ namespace {
     bool ponderMode = false;
 
     limits.startTime = now(); // As early as possible!
+    limits.deterministic = Options["Deterministic"];
 
     while (is >> token)
         if (token == "searchmoves")
@@ -136,6 +150,7 @@ namespace {
         else if (token == "movetime")  is >> limits.movetime;
         else if (token == "mate")      is >> limits.mate;
         else if (token == "perft")     is >> limits.perft;
+        else if (token == "divide")    limits.divide = true;
         else if (token == "infinite")  limits.infinite = 1;
         else if (token == "ponder")    ponderMode = true;
 
@@ -151,6 +166,8 @@ namespace {
 
     string token;
     uint64_t num, nodes = 0, cnt = 1;
+    uint64_t evalNodes[2] = {};
+    TimePoint evalTime[2] = {};
 
     vector<string> list = setup_bench(pos, args);
     num = count_if(list.begin(), list.end(), [](string s) { return s.find("go ") == 0; });
@@ -165,13 +182,27 @@ namespace {
         if (token == "go")
         {
             cerr << "\nPosition: " << cnt++ << '/' << num << endl;
+            TimePoint start = now();
             go(pos, is, states);
             Threads.main()->wait_for_search_finished();
             nodes += Threads.nodes_searched();
+            evalNodes[Eval::useNNUE] += Threads.nodes_searched();
+            evalTime[Eval::useNNUE] += now() - start;
         }
-        else if (token == "setoption")  setoption(is);
         else if (token == "position")   position(pos, is, states);
-        else if (token == "ucinewgame") { Search::clear(); elapsed = now(); } // Search::clear() may take some while
+        else if (token == "setoption" || token == "ucinewgame")
+        {
+            // Not timed: resizing the hash, loading a network and Search::clear()
+            // may take some while.
+            TimePoint start = now();
+
+            if (token == "setoption")
+                setoption(is);
+            else
+                Search::clear();
+
+            elapsed += now() - start;
+        }
     }
 
     elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
@@ -182,6 +213,517 @@ namespace {
          << "\nTotal time (ms) : " << elapsed
          << "\nNodes searched  : " << nodes
          << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+
+    // Speed of each evaluation used, measured over the searches only
+    for (bool useNNUE : { false, true })
+        if (evalNodes[useNNUE])
+            cerr << (useNNUE ? "NNUE nps        : " : "Classical nps   : ")
+                 << 1000 * evalNodes[useNNUE] / (evalTime[useNNUE] + 1) << endl;
+
+    Search::print_stats();
+  }
+
+
+  // see_exchange() is the swap algorithm of a full SEE, given the attackers of
+  // the destination square once the moving piece has left. The capture sequence
+  // follows the rules of Position::see_ge(), so that the value is the highest
+  // threshold for which see_ge() is true. It is used by the 'see' microbench
+  // only: the search keeps see_ge(), which stops as soon as the outcome against
+  // the threshold is known and is faster.
+
+  Value see_exchange(const Position& pos, Square from, Square to, Bitboard attackers) {
+
+    Value gain[32];  // gain[d] is the balance after d recaptures, for the side making the last one
+    Bitboard occupied = pos.pieces() ^ from ^ to;
+    Bitboard b, stmAttackers;
+    Color stm = color_of(pos.piece_on(from));
+    Value victim = PieceValue[MG][pos.piece_on(from)];
+    PieceType Pt;
+    int d = 0;
+
+    gain[0] = PieceValue[MG][pos.piece_on(to)];
+
+    // A king can not be recaptured, see the note in see_ge()
+    if (type_of(pos.piece_on(from)) == KING)
+        return gain[0];
+
+    while (true)
+    {
+        stm = ~stm;
+        attackers &= occupied;
+
+        if (!(stmAttackers = attackers & pos.pieces(stm)))
+            break;
+
+        // blockers_for_king() computes the pinners on first use
+        Bitboard blockers = pos.blockers_for_king(stm);
+
+        if (pos.state()->pinners[~stm] & occupied)
+            stmAttackers &= ~blockers;
+
+        if (!stmAttackers)
+            break;
+
+        for (Pt = PAWN; !(b = stmAttackers & pos.pieces(Pt)); ++Pt) {}
+
+        // A king recaptures only when the opponent has no attacker left
+        if (Pt == KING)
+        {
+            if (!(attackers & pos.pieces(~stm)))
+            {
+                gain[d + 1] = victim - gain[d];
+                ++d;
+            }
+            break;
+        }
+
+        gain[d + 1] = victim - gain[d];
+        victim = PieceValue[MG][Pt];
+        ++d;
+
+        occupied ^= lsb(b);
+
+        if (Pt == PAWN || Pt == BISHOP || Pt == QUEEN)
+            attackers |= attacks_bb<BISHOP>(to, occupied) & pos.pieces(BISHOP, QUEEN);
+
+        if (Pt == ROOK || Pt == QUEEN)
+            attackers |= attacks_bb<ROOK>(to, occupied) & pos.pieces(ROOK, QUEEN);
+    }
+
+    // Negamax the balances back, each side being free not to recapture
+    while (d--)
+        gain[d] = std::min(gain[d], -gain[d + 1]);
+
+    return gain[0];
+  }
+
+  // see_value() returns the full SEE value of a move
+  Value see_value(const Position& pos, Move m) {
+
+    if (type_of(m) != NORMAL)
+        return VALUE_ZERO;
+
+    Square from = from_sq(m), to = to_sq(m);
+
+    return see_exchange(pos, from, to, pos.attackers_to(to, pos.pieces() ^ from ^ to));
+  }
+
+  // see_batch() gives the SEE values of a list of moves. The attackers of a
+  // square are computed once for all the moves going to it, the x-rays behind
+  // the moving piece being added for each move.
+  void see_batch(const Position& pos, const ExtMove* begin, const ExtMove* end, Value* values) {
+
+    Bitboard attackers[SQUARE_NB], done = 0;
+
+    for (const ExtMove* m = begin; m < end; ++m)
+    {
+        if (type_of(*m) != NORMAL)
+        {
+            *values++ = VALUE_ZERO;
+            continue;
+        }
+
+        Square from = from_sq(*m), to = to_sq(*m);
+        Bitboard occupied = pos.pieces() ^ from ^ to;
+
+        if (!(done & to))
+        {
+            done |= to;
+            attackers[to] = pos.attackers_to(to);
+        }
+
+        Bitboard b = attackers[to];
+
+        if (PseudoAttacks[BISHOP][to] & from)
+            b |= attacks_bb<BISHOP>(to, occupied) & pos.pieces(BISHOP, QUEEN);
+
+        else if (PseudoAttacks[ROOK][to] & from)
+            b |= attacks_bb<ROOK>(to, occupied) & pos.pieces(ROOK, QUEEN);
+
+        *values++ = see_exchange(pos, from, to, b);
+    }
+  }
+
+  // score_quiets() gives the quiet moves the values of MovePicker::score<QUIETS>()
+  void score_quiets(const Position& pos, const Thread* th, const PieceToHistory** contHist,
+                    ExtMove* begin, ExtMove* end) {
+
+    for (ExtMove* m = begin; m < end; ++m)
+        m->value =      th->mainHistory[pos.side_to_move()][from_to(*m)]
+                  + 2 * (*contHist[0])[pos.moved_piece(*m)][to_sq(*m)]
+                  + 2 * (*contHist[1])[pos.moved_piece(*m)][to_sq(*m)]
+                  + 2 * (*contHist[3])[pos.moved_piece(*m)][to_sq(*m)]
+                  +     (*contHist[5])[pos.moved_piece(*m)][to_sq(*m)];
+  }
+
+
+  // microbench() is called when engine receives the "microbench" command. It
+  // times a single component of the engine on the bench positions, without
+  // searching, and prints the average time per call. The kernels are 'eval',
+  // the static evaluation, 'sliders', the attacks of all the bishops, rooks
+  // and queens of a position computed by slider_attacks() and by magic lookups,
+  // 'movepick', the MovePicker::next_move() calls of a main search node,
+  // with the histories of the main thread filled with random values (they are
+  // cleared afterwards), followed by the quiet stage alone, scoring and sorting
+  // all the quiets or scoring only those the search would try, and 'see', the
+  // SEE values of all the captures of a position computed in a batch and by a
+  // see_ge() call per capture.
+  // Usage: microbench <kernel> [iterations per position]
+
+  void microbench(Position& pos, istream& args, StateListPtr& states) {
+
+    typedef std::chrono::steady_clock Clock;
+
+    string kernel, token;
+    int iterations;
+
+    args >> kernel;
+    if (!(args >> iterations))
+        iterations = 100000;
+
+    istringstream benchArgs("16 1 1");
+    vector<string> list = setup_bench(pos, benchArgs);
+    uint64_t calls = 0, stages = 0, checksum = 0;
+    double ns = 0, refNs = 0, triedNs = 0;
+    bool match = true;
+
+    Thread* th = nullptr; // Set after the bench 'setoption' commands
+    const PieceToHistory* contHist[6];
+
+    for (const auto& cmd : list)
+    {
+        istringstream is(cmd);
+        is >> skipws >> token;
+
+        if (token == "setoption")
+            setoption(is);
+
+        if (token != "position")
+            continue;
+
+        position(pos, is, states);
+
+        if (kernel == "eval")
+        {
+            if (pos.checkers())
+                continue;
+
+            auto start = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+                checksum += Eval::evaluate(pos);
+
+            ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            calls += iterations;
+        }
+        else if (kernel == "sliders")
+        {
+            PieceType pt[32];
+            Square sq[32];
+            Bitboard occupied[32], attacks[32], reference[32];
+            Bitboard base = pos.pieces();
+            int n = 0;
+
+            for (Bitboard b = pos.pieces(BISHOP, ROOK) | pos.pieces(QUEEN); b; ++n)
+            {
+                sq[n] = pop_lsb(&b);
+                pt[n] = type_of(pos.piece_on(sq[n]));
+                occupied[n] = base;
+            }
+
+            if (!n)
+                continue;
+
+            auto start = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                occupied[0] = base ^ (i & 1); // Defeat loop invariant hoisting
+                slider_attacks(pt, sq, occupied, attacks, n);
+                checksum += attacks[0];
+            }
+
+            auto mid = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                occupied[0] = base ^ (i & 1);
+                for (int j = 0; j < n; ++j)
+                    reference[j] = attacks_bb(pt[j], sq[j], occupied[j]);
+                checksum += reference[0];
+            }
+
+            ns += std::chrono::duration<double, std::nano>(mid - start).count();
+            refNs += std::chrono::duration<double, std::nano>(Clock::now() - mid).count();
+            calls += iterations;
+
+            for (int j = 0; j < n; ++j)
+                match &= attacks[j] == reference[j];
+        }
+        else if (kernel == "see")
+        {
+            if (pos.checkers())
+                continue;
+
+            MoveList<CAPTURES> captures(pos);
+            Value values[MAX_MOVES];
+            size_t n = captures.size();
+
+            if (!n)
+                continue;
+
+            auto start = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                see_batch(pos, captures.begin(), captures.end(), values);
+                checksum += values[i % n];
+            }
+
+            auto mid = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+                for (const auto& m : captures)
+                    checksum += pos.see_ge(m, Value(i & 127));
+
+            ns += std::chrono::duration<double, std::nano>(mid - start).count();
+            refNs += std::chrono::duration<double, std::nano>(Clock::now() - mid).count();
+            calls += iterations * n;
+
+            // The value is exact if see_ge() switches from true to false there
+            for (size_t j = 0; j < n; ++j)
+                match &=   pos.see_ge(captures.begin()[j], values[j])
+                        && !pos.see_ge(captures.begin()[j], values[j] + 1)
+                        && see_value(pos, captures.begin()[j]) == values[j];
+        }
+        else if (kernel == "movepick")
+        {
+            if (!th)
+            {
+                th = Threads.main();
+                PRNG rng(1070372);
+
+                for (int c = 0; c < COLOR_NB; ++c)
+                    for (auto& h : th->mainHistory[c])
+                        h = rng.rand<int16_t>() % 10692;
+
+                for (auto& to : th->continuationHistory[0][0])
+                    for (auto& h : to)
+                    {
+                        PieceToHistory* pth = &h; // StatsEntry::operator&() gives the table
+
+                        for (auto& row : *pth)
+                            for (auto& e : row)
+                                e = rng.rand<int16_t>() % 29952;
+                    }
+
+                for (int i = 0; i < 6; ++i)
+                    contHist[i] = &th->continuationHistory[0][0][Piece(W_KNIGHT + i)][SQ_C3 + i];
+            }
+
+            Move killers[] = { MOVE_NONE, MOVE_NONE };
+            Move m;
+
+            auto start = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                MovePicker mp(pos, MOVE_NONE, 10, &th->mainHistory, &th->captureHistory,
+                              contHist, MOVE_NONE, killers);
+
+                while ((m = mp.next_move()) != MOVE_NONE)
+                    checksum += m, ++calls;
+            }
+
+            ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+            if (pos.checkers())
+                continue;
+
+            // The quiet stage as in MovePicker, then with only the share of the
+            // quiets that the search tries in bench (36%, see 'make stats=yes')
+            // scored and none sorted: the most that staged generation could save.
+            ExtMove quiets[MAX_MOVES];
+            int n = int(generate<QUIETS>(pos, quiets) - quiets);
+
+            if (!n)
+                continue;
+
+            int tried = (n * 36 + 99) / 100;
+
+            start = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                ExtMove* end = generate<QUIETS>(pos, quiets);
+                score_quiets(pos, th, contHist, quiets, end);
+                partial_insertion_sort(quiets, end, -3000 * 10);
+                checksum += quiets[0].move;
+            }
+
+            auto mid = Clock::now();
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                generate<QUIETS>(pos, quiets);
+                score_quiets(pos, th, contHist, quiets, quiets + tried);
+                checksum += quiets[0].value;
+            }
+
+            refNs += std::chrono::duration<double, std::nano>(mid - start).count();
+            triedNs += std::chrono::duration<double, std::nano>(Clock::now() - mid).count();
+            stages += iterations;
+        }
+        else
+        {
+            cerr << "Unknown kernel: " << kernel << endl;
+            return;
+        }
+    }
+
+    if (kernel == "movepick")
+        Search::clear();
+
+    cerr << "\n==========================="
+         << "\nKernel          : " << kernel
+         << "\nCalls           : " << calls
+         << "\nns/call         : " << ns / std::max(calls, uint64_t(1));
+
+    if (kernel == "movepick")
+        cerr << "\nQuiets ns/node  : " << refNs / std::max(stages, uint64_t(1))
+             << "\nTried ns/node   : " << triedNs / std::max(stages, uint64_t(1));
+
+    if (kernel == "sliders")
+        cerr << "\nMagic ns/call   : " << refNs / std::max(calls, uint64_t(1))
+             << "\nResults match   : " << (match ? "yes" : "no");
+
+    if (kernel == "see")
+        cerr << "\nsee_ge ns/call  : " << refNs / std::max(calls, uint64_t(1))
+             << "\nResults match   : " << (match ? "yes" : "no");
+
+    cerr << "\nChecksum        : " << checksum << endl;
+  }
+
+
+  // evalparams() is called when engine receives the "evalparams" command, in
+  // an engine built with 'make tune=yes'. It saves the evaluation parameters
+  // to a file or loads them from it, see tune.h. After loading, the tables
+  // derived from the parameters are recomputed and the current position is
+  // set again from its FEN, losing the move history.
+  // Usage: evalparams <save|load> <file>
+
+  void evalparams(Position& pos, istream& is, StateListPtr& states) {
+
+    string action, file;
+    is >> action >> file;
+
+    if (!Tune::Enabled)
+        sync_cout << "evalparams requires an engine built with 'make tune=yes'" << sync_endl;
+
+    else if (action == "save")
+        sync_cout << (Tune::save(file) ? "Parameters saved to " : "Unable to write ") << file << sync_endl;
+
+    else if (action == "load" && Tune::load(file))
+    {
+        Threads.main()->wait_for_search_finished();
+
+        PSQT::init();
+        Material::init();
+        Threads.set_pawn_hash();
+
+        for (Thread* th : Threads)
+        {
+            th->materialTable = Material::Table();
+            th->pawnsEntry = Pawns::Entry();
+        }
+
+        Search::clear();
+
+        string fen = pos.fen();
+        states = StateListPtr(new std::deque<StateInfo>(1));
+        pos.set(fen, Options["UCI_Chess960"], &states->back(), Threads.main());
+
+        sync_cout << "Parameters loaded from " << file << sync_endl;
+    }
+    else if (action != "load")
+        sync_cout << "Usage: evalparams <save|load> <file>" << sync_endl;
+  }
+
+
+  // evalbatch() is called when engine receives the "evalbatch" command. It
+  // evaluates the positions of a file, one FEN per line (anything after the
+  // six FEN fields is ignored), using all the threads of the pool, and writes
+  // one line per position in the same order: 'eval' writes the evaluation from
+  // the side to move's point of view, 'terms' writes the line of trace_terms()
+  // (see evaluate.cpp), for tuning. Positions in check give "none".
+  // Usage: evalbatch <eval|terms> <fen file> <output file>
+
+  void evalbatch(istream& is) {
+
+    typedef std::chrono::steady_clock Clock;
+
+    constexpr size_t ChunkSize = 1024;
+
+    string mode, inName, outName, line;
+    is >> mode >> inName >> outName;
+
+    ifstream in(inName);
+    ofstream out(outName);
+
+    if ((mode != "eval" && mode != "terms") || !in || !out)
+    {
+        sync_cout << "Usage: evalbatch <eval|terms> <fen file> <output file>" << sync_endl;
+        return;
+    }
+
+    vector<string> fens;
+
+    while (getline(in, line))
+        if (!line.empty())
+            fens.push_back(line);
+
+    Threads.main()->wait_for_search_finished();
+
+    vector<string> results(fens.size());
+    std::atomic<size_t> next(0);
+
+    // Each worker borrows the tables of a thread of the pool, idle meanwhile
+    auto worker = [&](Thread* th) {
+
+        StateInfo st;
+        Position p;
+
+        th->contempt = SCORE_ZERO;
+
+        for (size_t start; (start = next.fetch_add(ChunkSize)) < fens.size(); )
+            for (size_t i = start; i < std::min(start + ChunkSize, fens.size()); ++i)
+            {
+                p.set(fens[i], false, &st, th);
+
+                results[i] =  p.checkers()     ? "none"
+                            : mode == "terms" ? Eval::trace_terms(p)
+                                              : std::to_string(Eval::evaluate(p));
+            }
+    };
+
+    auto start = Clock::now();
+    vector<std::thread> workers;
+
+    for (Thread* th : Threads)
+        workers.emplace_back(worker, th);
+
+    for (auto& w : workers)
+        w.join();
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (const string& r : results)
+        out << r << "\n";
+
+    cerr << "\n==========================="
+         << "\nPositions       : " << fens.size()
+         << "\nThreads         : " << workers.size()
+         << "\nPositions/second: " << size_t(fens.size() / std::max(elapsed, 1e-6)) << endl;
   }
 
 } // namespace
@@ -239,6 +781,9 @@ void UCI::loop(int argc, char* argv[]) {
       // Do not use these commands during a search!
       else if (token == "flip")  pos.flip();
       else if (token == "bench") bench(pos, is, states);
+      else if (token == "microbench") microbench(pos, is, states);
+      else if (token == "evalparams") evalparams(pos, is, states);
+      else if (token == "evalbatch")  evalbatch(is);
       else if (token == "d")     sync_cout << pos << sync_endl;
       else if (token == "eval")
       {
@@ -23,8 +23,10 @@
 #include <ostream>
 #include <sstream>
 
+#include "evaluate.h"
 #include "misc.h"
 #include "search.h"
+#include "searchlog.h"
 #include "thread.h"
 #include "tt.h"
 #include "uci.h"
@@ -39,7 +41,11 @@ namespace UCI {
 /// 'On change' actions, triggered by an option's value change
 void on_clear_hash(const Option&) { Search::clear(); }
 void on_hash_size(const Option& o) { TT.resize(o); }
+void on_eval_hash_size(const Option& o) { EvalHash.resize(o); }
+void on_eval_file(const Option&) { Eval::init_NNUE(); }
+void on_pawn_hash(const Option&) { Threads.set_pawn_hash(); }
 void on_logger(const Option& o) { start_logger(o); }
+void on_search_log(const Option& o) { SearchLog::open(o); }
 void on_threads(const Option& o) { Threads.set(o); }
 void on_tb_path(const Option& o) { Tablebases::init(o); }
 
@@ -59,6 +65,13 @@ void init(OptionsMap& o) {
   // at most 2^32 clusters.
   constexpr int MaxHashMB = Is64Bit ? 131072 : 2048;
 
+  // The eval hash is also indexed by 32 bits, with 8 bytes per entry
+  constexpr int MaxEvalHashMB = Is64Bit ? 32768 : 2048;
+
+  // The default pawn hash size is rounded up to hold Pawns::DefaultEntries
+  constexpr int DefaultPawnHashMB = int((Pawns::DefaultEntries * sizeof(Pawns::Entry) + (1 << 20) - 1) >> 20);
+  constexpr int MaxPawnHashMB = Is64Bit ? 4096 : 256;
+
   o["Debug Log File"]        << Option("", on_logger);
   o["Analysis Contempt"]     << Option("Both var Off var White var Black var Both", "Both");
   o["Contempt"]              << Option(12, -100, 100);
@@ -66,12 +79,19 @@ void init(OptionsMap& o) {
   o["Virtual Threads"]       << Option(1, 1, 64);
   o["Hash"]                  << Option(16, 1, MaxHashMB, on_hash_size);
   o["Clear Hash"]            << Option(on_clear_hash);
+  o["Perft Hash"]            << Option(16, 0, MaxHashMB);
+  o["Eval Hash"]             << Option(0, 0, MaxEvalHashMB, on_eval_hash_size);
+  o["Pawn Hash"]             << Option(DefaultPawnHashMB, 1, MaxPawnHashMB, on_pawn_hash);
+  o["Shared Pawn Hash"]      << Option(false, on_pawn_hash);
+  o["Use NNUE"]              << Option(false, on_eval_file);
+  o["EvalFile"]              << Option("nn.nnue", on_eval_file);
   o["MultiPV"]               << Option(1, 1, 500);
   o["NullMove"]              << Option(true);
   o["Ponder"]                << Option(false);
   o["Minimum Thinking Time"] << Option(20, 0, 5000);
   o["Move Overhead"]         << Option(30, 0, 5000);
   o["Nodes As Time"]         << Option(0, 0, 10000);
+  o["Deterministic"]         << Option(false);
   o["Slow Mover"]            << Option(84, 10, 1000);
   o["UCI_Chess960"]          << Option(false);
   o["UCI_AnalyseMode"]       << Option(false);
@@ -80,6 +100,9 @@ void init(OptionsMap& o) {
   o["SyzygyPath"]            << Option("<empty>", on_tb_path);
   o["SyzygyProbeDepth"]      << Option(1, 1, 100);
   o["SyzygyProbeLimit"]      << Option(7, 0, 7);
+
+  if (SearchLog::Enabled)
+      o["Search Log File"]   << Option("", on_search_log);
 }
 
 
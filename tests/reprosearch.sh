@@ -58,4 +58,27 @@ done
 
 rm repeat.exp
 
+# in deterministic mode the whole output, reported time and nps included,
+# must be identical between runs, also when searching with a clock.
+cat << EOF > deterministic.exp
+ set timeout 30
+ spawn ./stockfish
+
+ send "setoption name Deterministic value true\n"
+ send "position startpos moves e2e4\n"
+ send "go wtime 2000 btime 2000\n"
+ expect "bestmove"
+
+ send "quit\n"
+ expect eof
+EOF
+
+echo "reprosearch testing deterministic mode"
+
+expect deterministic.exp 2>&1 | grep -E "^(info|bestmove)" > deterministic1.txt
+expect deterministic.exp 2>&1 | grep -E "^(info|bestmove)" > deterministic2.txt
+cmp deterministic1.txt deterministic2.txt
+
+rm deterministic.exp deterministic1.txt deterministic2.txt
+
 echo "reprosearch testing OK"